@@ -0,0 +1,283 @@
+#include "Benchmark.h"
+#include "TextTableFile.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <fstream>
+#include <random>
+#include <omp.h>
+
+typedef std::chrono::steady_clock Clock;
+
+static double secondsSince(Clock::time_point const &t0) {
+    return std::chrono::duration<double>(Clock::now() - t0).count();
+}
+
+void Benchmark::startPasswords(RainbowTable const &table, Password *pwds, unsigned int n) {
+    for (unsigned int i = 0; i < n; ++i)
+        pwds[i].set(table.randomPassword());
+}
+
+double Benchmark::chainSteps(RainbowTable const &table, unsigned long nSteps) {
+    const unsigned long nChains = (nSteps + table.chainLen - 1) / table.chainLen;
+
+    Password pwd;
+    unsigned char hash[HASH_SIZE];
+
+    startPasswords(table, &pwd, 1);
+
+    Clock::time_point t0 = Clock::now();
+
+    for (unsigned long i = 0; i < nChains; ++i) {
+        table.createChain(pwd, hash);
+        // Chain the chains, so that the work cannot be skipped.
+        pwd.data[0] = table.domain[hash[0] % table.domain.size()];
+    }
+
+    return nChains * table.chainLen / secondsSince(t0);
+}
+
+double Benchmark::chainStepsBatch(RainbowTable const &table, unsigned long nSteps) {
+    const unsigned long nBatches = (nSteps + CHAIN_BATCH * table.chainLen - 1) / (CHAIN_BATCH * table.chainLen);
+
+    Password pwds[CHAIN_BATCH];
+    unsigned char hashes[CHAIN_BATCH * HASH_SIZE];
+
+    startPasswords(table, pwds, CHAIN_BATCH);
+
+    Clock::time_point t0 = Clock::now();
+
+    for (unsigned long i = 0; i < nBatches; ++i)
+        table.createChains(pwds, CHAIN_BATCH, hashes);
+
+    return nBatches * CHAIN_BATCH * table.chainLen / secondsSince(t0);
+}
+
+/**
+ * Random hashes, which are almost surely not end hashes.
+ */
+static std::vector<unsigned char> missingHashes(unsigned int n) {
+    std::mt19937_64 mt(42);
+    std::vector<unsigned char> hashes((size_t) n * HASH_SIZE);
+
+    for (unsigned char &byte : hashes)
+        byte = mt();
+
+    return hashes;
+}
+
+double Benchmark::missLookups(RainbowTable const &table, unsigned int nLookups) {
+    std::vector<unsigned char> hashes = missingHashes(nLookups);
+    size_t first;
+    unsigned int nFound = 0;
+
+    Clock::time_point t0 = Clock::now();
+
+    for (unsigned int i = 0; i < nLookups; ++i)
+        nFound += table.table->findPassword(&hashes[(size_t) i * HASH_SIZE], first);
+
+    double time = secondsSince(t0);
+
+    // Keep the lookups from being optimized away.
+    if (nFound == nLookups + 1)
+        return 0.0;
+
+    return nLookups / time;
+}
+
+double Benchmark::missLookupsBatch(RainbowTable const &table, unsigned int nLookups) {
+    std::vector<unsigned char> hashes = missingHashes(nLookups);
+    size_t first[LOOKUP_BATCH];
+    unsigned int counts[LOOKUP_BATCH], nFound = 0;
+
+    Clock::time_point t0 = Clock::now();
+
+    for (unsigned int i = 0; i < nLookups; i += LOOKUP_BATCH) {
+        unsigned int n = nLookups - i < LOOKUP_BATCH ? nLookups - i : LOOKUP_BATCH;
+        table.table->findPasswords(&hashes[(size_t) i * HASH_SIZE], n, first, counts);
+        nFound += counts[0];
+    }
+
+    double time = secondsSince(t0);
+
+    if (nFound == nLookups + 1)
+        return 0.0;
+
+    return nLookups / time;
+}
+
+std::vector<unsigned char> Benchmark::randomHashes(RainbowTable const &table, unsigned int n) {
+    std::mt19937 mt(42);
+    std::uniform_int_distribution<unsigned int> dist(0, table.domain.size() - 1);
+
+    std::uniform_int_distribution<uint64_t> index(0, table.keyspace.size() - 1);
+
+    std::vector<unsigned char> hashes((size_t) n * HASH_SIZE);
+    Password pwd{};
+    pwd.len = table.pwdLen;
+
+    for (unsigned int i = 0; i < n; ++i) {
+        if (table.keyspace.uniform()) {
+            for (unsigned int j = 0; j < table.pwdLen; ++j)
+                pwd.data[j] = table.domain[dist(mt)];
+        } else {
+            table.keyspace.unrank(index(mt), pwd);
+        }
+        table.hashPassword(pwd, &hashes[(size_t) i * HASH_SIZE]);
+    }
+
+    return hashes;
+}
+
+double Benchmark::crackLatency(RainbowTable const &table, unsigned int nHashes, int nThreads) {
+    std::vector<unsigned char> hashes = randomHashes(table, nHashes);
+
+    const int maxThreads = omp_get_max_threads();
+    omp_set_num_threads(nThreads);
+
+    Clock::time_point t0 = Clock::now();
+
+    for (unsigned int i = 0; i < nHashes; ++i)
+        table.crackHash(&hashes[(size_t) i * HASH_SIZE]);
+
+    double time = secondsSince(t0);
+
+    omp_set_num_threads(maxThreads);
+
+    return time / nHashes;
+}
+
+double Benchmark::uniqueEnds(RainbowTable const &table) {
+    Table const &rows = *table.table;
+    const size_t n = rows.size();
+
+    if (n == 0 || rows.isCompact())
+        return 0.0;
+
+    // The end hashes are sorted, so that the duplicates are next to each other.
+    Endpoint const *ends = rows.endData();
+    size_t nUnique = 1;
+
+    for (size_t i = 1; i < n; ++i)
+        nUnique += ends[i].hi != ends[i - 1].hi || ends[i].lo != ends[i - 1].lo;
+
+    return (double) nUnique / n;
+}
+
+double Benchmark::successRate(RainbowTable const &table, unsigned int nHashes) {
+    std::vector<unsigned char> hashes = randomHashes(table, nHashes);
+    std::vector<std::string> results;
+
+    table.crackHashes(hashes.data(), nHashes, results);
+
+    return (double) std::count_if(results.begin(), results.end(),
+                                  [](std::string const &pwd) { return !pwd.empty(); }) / nHashes;
+}
+
+double Benchmark::hashRate(HashMethod const &hashMethod, unsigned int pwdLen, unsigned long nHashes) {
+    const unsigned long nBatches = (nHashes + CHAIN_BATCH - 1) / CHAIN_BATCH;
+
+    Password pwds[CHAIN_BATCH]{};
+    unsigned char hashes[CHAIN_BATCH * HASH_SIZE];
+
+    for (unsigned int i = 0; i < CHAIN_BATCH; ++i) {
+        pwds[i].len = pwdLen;
+        memset(pwds[i].data, 'a' + i % 26, pwdLen);
+    }
+
+    Clock::time_point t0 = Clock::now();
+
+    for (unsigned long i = 0; i < nBatches; ++i) {
+        hashMethod.hashBatch(pwds, CHAIN_BATCH, hashes);
+        // Feed the hashes back, so that the work cannot be skipped.
+        for (unsigned int j = 0; j < CHAIN_BATCH; ++j)
+            pwds[j].data[0] = hashes[j * HASH_SIZE];
+    }
+
+    return nBatches * CHAIN_BATCH / secondsSince(t0);
+}
+
+double Benchmark::reduceRate(RainbowTable const &table, unsigned long nReductions) {
+    const unsigned int nHashes = 4096;
+    std::vector<unsigned char> hashes = missingHashes(nHashes);
+
+    Password pwd{};
+    unsigned int column = 0, sink = 0;
+
+    Clock::time_point t0 = Clock::now();
+
+    for (unsigned long i = 0; i < nReductions; ++i) {
+        table.reduce(&hashes[(i % nHashes) * HASH_SIZE], column, pwd);
+        sink += pwd.data[0];
+        if (++column == table.chainLen)
+            column = 0;
+    }
+
+    double time = secondsSince(t0);
+
+    if (sink == 1)
+        return 0.0;
+
+    return nReductions / time;
+}
+
+double Benchmark::buildTime(unsigned int nChains, unsigned int pwdLen) {
+    std::vector<unsigned char> hashes = missingHashes(nChains);
+    TableBuilder builder(nChains, pwdLen);
+    Password pwd{};
+
+    pwd.len = pwdLen;
+    memset(pwd.data, 'a', pwdLen);
+
+    builder.append(nChains);
+    for (unsigned int i = 0; i < nChains; ++i)
+        builder.set(i, pwd, &hashes[(size_t) i * HASH_SIZE]);
+
+    Clock::time_point t0 = Clock::now();
+    Table *table = builder.build();
+    double time = secondsSince(t0);
+
+    delete table;
+    return time;
+}
+
+bool Benchmark::fileRates(RainbowTable const &table, std::string const &filePath, double &bytes,
+                          double &writeRate, double &readRate) {
+    TableFileHeader header{};
+    table.getParameters(header);
+
+    const bool binary = TableFile::hasTableExtension(filePath);
+
+    Clock::time_point t0 = Clock::now();
+    bool written = binary ? TableFile::write(filePath, header, *table.table)
+                          : TextTableFile::write(filePath, header, *table.table);
+    double writeTime = secondsSince(t0);
+
+    if (!written)
+        return false;
+
+    std::ifstream file(filePath, std::ios::binary | std::ios::ate);
+    bytes = (double) file.tellg();
+    file.close();
+
+    t0 = Clock::now();
+    Table *read = binary ? TableFile::open(filePath, header) : TextTableFile::read(filePath, header);
+
+    // A mapped file is only read when its chains are.
+    uint64_t sink = 0;
+    if (read && binary && !read->isCompact()) {
+        Endpoint const *ends = read->endData();
+        for (size_t i = 0; i < read->size(); ++i)
+            sink += ends[i].hi;
+    }
+
+    double readTime = secondsSince(t0);
+
+    bool ok = read != nullptr && read->size() == table.table->size() && sink != 1;
+    delete read;
+    std::remove(filePath.c_str());
+
+    writeRate = bytes / writeTime;
+    readRate = bytes / readTime;
+    return ok;
+}
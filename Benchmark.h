@@ -0,0 +1,128 @@
+#ifndef RAINBOWHACKING_BENCHMARK_H
+#define RAINBOWHACKING_BENCHMARK_H
+
+#include "RainbowTable.h"
+
+/**
+ * Throughput measurements on the hot paths of a table.
+ * Chain steps are measured on a single thread.
+ */
+class Benchmark {
+
+private:
+    /**
+     * Fills passwords with the start passwords of a table.
+     */
+    static void startPasswords(RainbowTable const &table, Password *pwds, unsigned int n);
+
+    /**
+     * Hashes of random passwords of a table, the same ones for the same
+     * parameters, one after another.
+     */
+    static std::vector<unsigned char> randomHashes(RainbowTable const &table, unsigned int n);
+
+public:
+    /**
+     * Measures chain steps (hash + reduce) per second, one chain at a time.
+     * @param table: The table whose parameters are used.
+     * @param nSteps: Approximate number of steps to run.
+     * @return The number of steps per second.
+     */
+    static double chainSteps(RainbowTable const &table, unsigned long nSteps);
+
+    /**
+     * Measures chain steps per second, CHAIN_BATCH chains in lockstep.
+     * @param table: The table whose parameters are used.
+     * @param nSteps: Approximate number of steps to run.
+     * @return The number of steps per second.
+     */
+    static double chainStepsBatch(RainbowTable const &table, unsigned long nSteps);
+
+    /**
+     * Measures lookups of end hashes which are not in the table, the case
+     * of most columns walked when cracking a hash.
+     * @param table: The table to look up.
+     * @param nLookups: Number of lookups.
+     * @return The number of lookups per second.
+     */
+    static double missLookups(RainbowTable const &table, unsigned int nLookups);
+
+    /**
+     * Measures the same lookups as missLookups(), LOOKUP_BATCH at a time
+     * through Table::findPasswords().
+     * @param table: The table to look up.
+     * @param nLookups: Number of lookups.
+     * @return The number of lookups per second.
+     */
+    static double missLookupsBatch(RainbowTable const &table, unsigned int nLookups);
+
+    /**
+     * Measures the time to crack a hash with a given number of threads.
+     * The hashes are those of the same random passwords whatever the
+     * number of threads, so that the results can be compared.
+     * @param table: The table to crack with.
+     * @param nHashes: Number of hashes to crack.
+     * @param nThreads: Number of threads.
+     * @return The average time per hash, in seconds.
+     */
+    static double crackLatency(RainbowTable const &table, unsigned int nHashes, int nThreads);
+
+    /**
+     * Measures the part of the chains of a table which end at distinct end
+     * hashes, the others having merged with another chain. Lower with a
+     * reduction function whose passwords collide more often.
+     * @param table: The table, not compact.
+     * @return The number of distinct end hashes over the number of chains.
+     */
+    static double uniqueEnds(RainbowTable const &table);
+
+    /**
+     * Measures the part of the passwords of the keyspace a table cracks,
+     * on the hashes of random passwords.
+     * @param table: The table to crack with.
+     * @param nHashes: Number of hashes to crack.
+     * @return The number of hashes cracked over nHashes.
+     */
+    static double successRate(RainbowTable const &table, unsigned int nHashes);
+
+    /**
+     * Measures hashes per second of a hashing method, CHAIN_BATCH passwords at a time.
+     * @param hashMethod: The hashing method.
+     * @param pwdLen: Length of the passwords hashed.
+     * @param nHashes: Approximate number of hashes to compute.
+     * @return The number of hashes per second.
+     */
+    static double hashRate(HashMethod const &hashMethod, unsigned int pwdLen, unsigned long nHashes);
+
+    /**
+     * Measures reductions per second with the reduction function of a table,
+     * at every column in turn.
+     * @param table: The table whose parameters are used.
+     * @param nReductions: Number of reductions.
+     * @return The number of reductions per second.
+     */
+    static double reduceRate(RainbowTable const &table, unsigned long nReductions);
+
+    /**
+     * Measures the time TableBuilder::build() takes to sort chains of random end hashes.
+     * @param nChains: Number of chains.
+     * @param pwdLen: Length of their start passwords.
+     * @return The time of the build, in seconds.
+     */
+    static double buildTime(unsigned int nChains, unsigned int pwdLen);
+
+    /**
+     * Measures writing a table to a file, and reading it back. A binary
+     * table file is mapped, so its reading counts a pass over its chains.
+     * @param table: The table to write.
+     * @param filePath: Path of the file, whose extension selects the format. Removed afterwards.
+     * @param bytes: Placeholder for the size of the file.
+     * @param writeRate: Placeholder for the bytes written per second.
+     * @param readRate: Placeholder for the bytes read per second.
+     * @return false if the file could not be written or read back.
+     */
+    static bool fileRates(RainbowTable const &table, std::string const &filePath, double &bytes,
+                          double &writeRate, double &readRate);
+};
+
+#endif //RAINBOWHACKING_BENCHMARK_H
@@ -0,0 +1,113 @@
+#ifndef RAINBOWHACKING_BITARRAY_HPP
+#define RAINBOWHACKING_BITARRAY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/**
+ * Array of unsigned integers of a fixed number of bits, packed one after another.
+ * The words are either owned, or a read-only view of memory owned by someone
+ * else, such as a mapped table file.
+ */
+class BitArray {
+
+private:
+    std::vector<uint64_t> words;
+    uint64_t const *view;   /* Words of a read-only array, nullptr if they are owned */
+    size_t nWords;
+    unsigned int width;     /* Bits of every value, 1 to 64 */
+    uint64_t mask;
+
+    uint64_t const *data() const {
+        return view ? view : words.data();
+    }
+
+public:
+    BitArray() : view(nullptr), nWords(0), width(0), mask(0) {}
+
+    /**
+     * Constructor
+     * @param n: Number of values.
+     * @param width: Bits of every value, 1 to 64.
+     */
+    BitArray(size_t n, unsigned int width) : view(nullptr), width(width) {
+        mask = width >= 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << width) - 1;
+        nWords = wordCount(n, width);
+        words.assign(nWords, 0);
+    }
+
+    /**
+     * Read-only view constructor. set() must not be called.
+     * @param words: The wordCount(n, width) words of the array, kept alive by the caller.
+     * @param n: Number of values.
+     * @param width: Bits of every value, 1 to 64.
+     */
+    BitArray(uint64_t const *words, size_t n, unsigned int width) : view(words), width(width) {
+        mask = width >= 64 ? ~(uint64_t) 0 : ((uint64_t) 1 << width) - 1;
+        nWords = wordCount(n, width);
+    }
+
+    /**
+     * @return the number of words storing <n> values of <width> bits.
+     */
+    static size_t wordCount(size_t n, unsigned int width) {
+        // One extra word, so that reads never need to check the end.
+        return (n * width + 63) / 64 + 1;
+    }
+
+    /**
+     * @return the words of the array, wordCount() of them.
+     */
+    uint64_t const *getWords() const {
+        return data();
+    }
+
+    /**
+     * @return an array owning a copy of the words of this one.
+     */
+    BitArray copy() const {
+        BitArray array;
+        array.words.assign(data(), data() + nWords);
+        array.nWords = nWords;
+        array.width = width;
+        array.mask = mask;
+        return array;
+    }
+
+    unsigned int getWidth() const {
+        return width;
+    }
+
+    uint64_t get(size_t i) const {
+        size_t bit = i * width;
+        unsigned int offset = bit & 63u;
+        uint64_t const *w = data() + (bit >> 6u);
+
+        uint64_t value = w[0] >> offset;
+        if (offset + width > 64)
+            value |= w[1] << (64 - offset);
+
+        return value & mask;
+    }
+
+    void set(size_t i, uint64_t value) {
+        size_t bit = i * width;
+        unsigned int offset = bit & 63u;
+        uint64_t *w = &words[bit >> 6u];
+
+        value &= mask;
+        w[0] = (w[0] & ~(mask << offset)) | (value << offset);
+        if (offset + width > 64)
+            w[1] = (w[1] & ~(mask >> (64 - offset))) | (value >> (64 - offset));
+    }
+
+    /**
+     * @return the memory used, in bytes.
+     */
+    size_t memoryUsage() const {
+        return nWords * sizeof(uint64_t);
+    }
+};
+
+#endif //RAINBOWHACKING_BITARRAY_HPP
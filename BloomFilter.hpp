@@ -0,0 +1,171 @@
+#ifndef RAINBOWHACKING_BLOOMFILTER_HPP
+#define RAINBOWHACKING_BLOOMFILTER_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+#include <algorithm>
+
+#define BLOOM_BLOCK_WORDS 8     /* Words of a block, a cache line */
+#define BLOOM_BLOCK_BITS 512
+#define BLOOM_MAX_BITS_PER_KEY 64
+
+/* Multipliers picking the bit of every word of a block */
+const uint32_t BLOOM_SALTS[BLOOM_BLOCK_WORDS] = {
+        0x47b6137bu, 0x44974d91u, 0x8824ad5bu, 0xa2b7289du,
+        0x705495c7u, 0x2df1424bu, 0x9efc4947u, 0x5c6bfb31u
+};
+
+/**
+ * Blocked Bloom filter over end hashes.
+ *
+ * Every end hash selects a block of a cache line, and sets a single bit in
+ * each of its 8 words. Checking a hash reads that one cache line, and most
+ * hashes which were never added are rejected there. The hashes being MD5
+ * outputs, their own bits select the block and the bits.
+ *
+ * The blocks are either owned, or a read-only view of memory owned by
+ * someone else, such as a mapped table file.
+ */
+class BloomFilter {
+
+private:
+    std::vector<uint64_t> storage;  /* Owned blocks, plus room to align them on a cache line */
+    uint64_t const *view;           /* Blocks of a read-only filter, nullptr if they are owned */
+    size_t nBlocks;
+
+    uint64_t const *data() const {
+        if (view)
+            return view;
+        auto address = reinterpret_cast<uintptr_t>(storage.data());
+        return reinterpret_cast<uint64_t const *>((address + 63) & ~(uintptr_t) 63);
+    }
+
+    static inline uint32_t key(uint64_t hi) {
+        return (uint32_t) hi ^ (uint32_t) (hi >> 32u);
+    }
+
+public:
+    BloomFilter() : view(nullptr), nBlocks(0) {}
+
+    /**
+     * Constructor
+     * @param n: Number of hashes to add.
+     * @param bitsPerKey: Bits of the filter per hash.
+     */
+    BloomFilter(size_t n, unsigned int bitsPerKey) : view(nullptr) {
+        nBlocks = blockCount(n, bitsPerKey);
+        storage.assign(nBlocks * BLOOM_BLOCK_WORDS + BLOOM_BLOCK_WORDS - 1, 0);
+    }
+
+    /**
+     * Read-only view constructor. add() must not be called.
+     * @param blocks: The words of the blocks, kept alive by the caller.
+     * @param nBlocks: Number of blocks.
+     */
+    BloomFilter(uint64_t const *blocks, size_t nBlocks) : view(blocks), nBlocks(nBlocks) {}
+
+    /**
+     * @return the number of blocks of a filter of <n> hashes.
+     */
+    static size_t blockCount(size_t n, unsigned int bitsPerKey) {
+        size_t blocks = (n * bitsPerKey + BLOOM_BLOCK_BITS - 1) / BLOOM_BLOCK_BITS;
+        return blocks > 0 ? blocks : 1;
+    }
+
+    /**
+     * @return the index of the block of an end hash, in a filter of <nBlocks> blocks.
+     * @param lo: The last 8 bytes of the hash, big-endian.
+     */
+    static inline size_t blockIndex(uint64_t lo, size_t nBlocks) {
+        return (size_t) (((unsigned __int128) lo * nBlocks) >> 64u);
+    }
+
+    /**
+     * Sets the bits of an end hash in its block, so that blocks can be
+     * filled outside of a filter, a range at a time.
+     * @param block: The BLOOM_BLOCK_WORDS words of the block.
+     * @param hi: The first 8 bytes of the hash, big-endian.
+     */
+    static inline void addToBlock(uint64_t *block, uint64_t hi) {
+        uint32_t k = key(hi);
+
+        for (unsigned int w = 0; w < BLOOM_BLOCK_WORDS; ++w)
+            block[w] |= (uint64_t) 1 << ((k * BLOOM_SALTS[w]) >> 26u);
+    }
+
+    /**
+     * @return true if the filter has no block, and accepts every hash.
+     */
+    bool empty() const {
+        return nBlocks == 0;
+    }
+
+    /**
+     * @return the words of the blocks.
+     */
+    uint64_t const *getBlocks() const {
+        return data();
+    }
+
+    size_t getBlockCount() const {
+        return nBlocks;
+    }
+
+    /**
+     * @return a filter owning a copy of the blocks of this one.
+     */
+    BloomFilter copy() const {
+        BloomFilter filter;
+        filter.nBlocks = nBlocks;
+        filter.storage.assign(nBlocks * BLOOM_BLOCK_WORDS + BLOOM_BLOCK_WORDS - 1, 0);
+        std::copy(data(), data() + nBlocks * BLOOM_BLOCK_WORDS, const_cast<uint64_t *>(filter.data()));
+        return filter;
+    }
+
+    /**
+     * Adds an end hash.
+     * @param hi: The first 8 bytes of the hash, big-endian.
+     * @param lo: The last 8 bytes of the hash, big-endian.
+     */
+    void add(uint64_t hi, uint64_t lo) {
+        addToBlock(const_cast<uint64_t *>(data()) + blockIndex(lo, nBlocks) * BLOOM_BLOCK_WORDS, hi);
+    }
+
+    /**
+     * Checks an end hash.
+     * @return false if the hash has never been added, true if it may have been.
+     */
+    bool mayContain(uint64_t hi, uint64_t lo) const {
+        if (nBlocks == 0)
+            return true;
+
+        uint64_t const *b = data() + blockIndex(lo, nBlocks) * BLOOM_BLOCK_WORDS;
+        uint32_t k = key(hi);
+        uint64_t found = 1;
+
+        for (unsigned int w = 0; w < BLOOM_BLOCK_WORDS; ++w)
+            found &= b[w] >> ((k * BLOOM_SALTS[w]) >> 26u);
+
+        return found != 0;
+    }
+
+    /**
+     * Starts loading the block of an end hash, so that checking many hashes
+     * keeps many cache misses in flight.
+     * @param lo: The last 8 bytes of the hash, big-endian.
+     */
+    void prefetch(uint64_t lo) const {
+        if (nBlocks > 0)
+            __builtin_prefetch(data() + blockIndex(lo, nBlocks) * BLOOM_BLOCK_WORDS);
+    }
+
+    /**
+     * @return the memory used by the blocks, in bytes.
+     */
+    size_t memoryUsage() const {
+        return nBlocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+    }
+};
+
+#endif //RAINBOWHACKING_BLOOMFILTER_HPP
@@ -0,0 +1,145 @@
+#ifndef RAINBOWHACKING_BUCKETDIRECTORY_HPP
+#define RAINBOWHACKING_BUCKETDIRECTORY_HPP
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+#define DIRECTORY_MAX_BITS 30           /* Largest directory, 8 GB */
+#define DIRECTORY_CHAINS_PER_BUCKET 4   /* Fewest chains per bucket on average, 1 or 2 cache lines */
+
+/**
+ * Directory of the sorted end hashes of a flat table, by their top bits.
+ *
+ * The end hashes being MD5 outputs, they are spread evenly across the
+ * buckets, so the few chains of a bucket are found from its offset
+ * directly: a lookup reads the directory entry, then the one or two cache
+ * lines of the bucket, whatever the size of the table.
+ *
+ * The offsets are either owned, or a read-only view of memory owned by
+ * someone else, such as a mapped table file.
+ */
+class BucketDirectory {
+
+private:
+    std::vector<uint64_t> storage;  /* Owned offsets */
+    uint64_t const *view;           /* Offsets of a read-only directory, nullptr if they are owned */
+    unsigned int bits;              /* Bits of the end hashes selecting the bucket, 0 for no directory */
+    unsigned int zeroBits;          /* Top bits of the end hashes skipped, always zero */
+    size_t next;                    /* First offset not filled in yet, while building */
+
+    uint64_t const *data() const {
+        return view ? view : storage.data();
+    }
+
+public:
+    BucketDirectory() : view(nullptr), bits(0), zeroBits(0), next(0) {}
+
+    /**
+     * Constructor of a directory to build, giving it the end hashes in order with add().
+     * @param bits: Bits selecting the bucket, from 1 to DIRECTORY_MAX_BITS.
+     * @param zeroBits: Top bits of every end hash known to be zero, skipped.
+     */
+    BucketDirectory(unsigned int bits, unsigned int zeroBits)
+            : storage(entryCount(bits)), view(nullptr), bits(bits), zeroBits(zeroBits), next(0) {}
+
+    /**
+     * Read-only view constructor.
+     * @param offsets: The entryCount(bits) offsets, kept alive by the caller.
+     */
+    BucketDirectory(uint64_t const *offsets, unsigned int bits, unsigned int zeroBits)
+            : view(offsets), bits(bits), zeroBits(zeroBits), next(0) {}
+
+    /**
+     * @return the number of offsets of a directory: one per bucket, plus the end of the last one.
+     */
+    static size_t entryCount(unsigned int bits) {
+        return ((size_t) 1 << bits) + 1;
+    }
+
+    /**
+     * @return the bits of a directory of <n> chains, DIRECTORY_CHAINS_PER_BUCKET to twice as many per bucket.
+     */
+    static unsigned int defaultBits(size_t n, unsigned int zeroBits) {
+        unsigned int bits = 1;
+
+        while (bits < DIRECTORY_MAX_BITS && bits < 64 - zeroBits
+               && ((size_t) DIRECTORY_CHAINS_PER_BUCKET << (bits + 1)) <= n)
+            ++bits;
+
+        return bits;
+    }
+
+    /**
+     * @return the bucket of an end hash.
+     * @param hi: The first 8 bytes of the hash, big-endian.
+     */
+    static inline size_t bucket(uint64_t hi, unsigned int bits, unsigned int zeroBits) {
+        return (hi << zeroBits) >> (64 - bits);
+    }
+
+    inline size_t bucket(uint64_t hi) const {
+        return bucket(hi, bits, zeroBits);
+    }
+
+    /**
+     * Adds the next end hash, not lower than the ones added so far.
+     * @param i: Index of the chain.
+     * @param hi: The first 8 bytes of its end hash, big-endian.
+     */
+    void add(uint64_t i, uint64_t hi) {
+        for (size_t b = bucket(hi); next <= b; ++next)
+            storage[next] = i;
+    }
+
+    /**
+     * Ends the directory, once all the end hashes are added.
+     * @param n: Number of chains.
+     */
+    void finish(uint64_t n) {
+        for (; next < storage.size(); ++next)
+            storage[next] = n;
+    }
+
+    /**
+     * @return the index of the first chain of a bucket, or the number of chains for the bucket past the last one.
+     */
+    inline uint64_t offset(size_t bucket) const {
+        return data()[bucket];
+    }
+
+    /**
+     * Starts loading the offsets of a bucket.
+     */
+    void prefetch(size_t bucket) const {
+        __builtin_prefetch(data() + bucket);
+    }
+
+    /**
+     * @return true if there is no directory.
+     */
+    bool empty() const {
+        return bits == 0;
+    }
+
+    unsigned int getBits() const {
+        return bits;
+    }
+
+    unsigned int getZeroBits() const {
+        return zeroBits;
+    }
+
+    uint64_t const *getOffsets() const {
+        return data();
+    }
+
+    /**
+     * @return the memory used by the offsets, in bytes.
+     */
+    size_t memoryUsage() const {
+        return bits > 0 ? entryCount(bits) * sizeof(uint64_t) : 0;
+    }
+};
+
+#endif //RAINBOWHACKING_BUCKETDIRECTORY_HPP
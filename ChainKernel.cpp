@@ -0,0 +1,225 @@
+#include "ChainKernel.h"
+#include "MD5Block.hpp"
+#include "MD4Block.hpp"
+#include "MD5Multi.h"
+#include "Reduction.hpp"
+
+/**
+ * MD5, inlined for passwords of a fixed length.
+ */
+struct MD5Kernel {
+    template <unsigned int Len>
+    static inline void hash(unsigned char const *pwd, unsigned char *digest) {
+        MD5Block::hashFixed<Len>(pwd, digest);
+    }
+
+    template <unsigned int Len>
+    static inline void hashBatch(Password const *pwds, unsigned int n, unsigned char *hashes) {
+        MD5Multi::hash(pwds, n, hashes);
+    }
+};
+
+/**
+ * NTLM, inlined for passwords of a fixed length.
+ */
+struct NTLMKernel {
+    template <unsigned int Len>
+    static inline void hash(unsigned char const *pwd, unsigned char *digest) {
+        MD4Block::ntlmFixed<Len>(pwd, digest);
+    }
+
+    template <unsigned int Len>
+    static inline void hashBatch(Password const *pwds, unsigned int n, unsigned char *hashes) {
+        MD5Multi::ntlm(pwds, n, hashes);
+    }
+};
+
+/**
+ * Kernel of passwords of <PwdLen> characters of a domain of <DomainSize>
+ * characters, hashed by <Hash> and reduced by the reduction function <Reduce>.
+ */
+template <class Hash, unsigned int Reduce, unsigned int PwdLen, unsigned int DomainSize>
+class FixedChainKernel : public ChainKernel {
+
+private:
+    char domain[DomainSize]{};
+    uint64_t offset;        /* Column offset of the table in its set */
+    unsigned char salt;     /* Byte xored with the hash, the index of the table in its set */
+
+    inline void reduceOne(unsigned char const *hash, unsigned int column, Password &pwd) const {
+        Reduction::reduce<PwdLen, DomainSize>(Reduce, hash, column, offset, salt, domain, PwdLen, DomainSize, pwd);
+    }
+
+public:
+    FixedChainKernel(std::string const &domain, unsigned int chainLen, unsigned int tableIndex)
+            : offset((uint64_t) tableIndex * chainLen), salt(tableIndex) {
+        domain.copy(this->domain, DomainSize);
+    }
+
+    bool specialized() const override {
+        return true;
+    }
+
+    void reduce(unsigned char const *hash, unsigned int column, Password &pwd) const override {
+        reduceOne(hash, column, pwd);
+    }
+
+    void reduceBatch(unsigned char const *hashes, unsigned int n, unsigned int column,
+                     Password *pwds) const override {
+        for (unsigned int j = 0; j < n; ++j)
+            reduceOne(hashes + j * HASH_SIZE, column, pwds[j]);
+    }
+
+    void hashBatch(Password const *pwds, unsigned int n, unsigned char *hashes) const override {
+        Hash::template hashBatch<PwdLen>(pwds, n, hashes);
+    }
+
+    void walk(Password &pwd, unsigned char *hash, unsigned int from, unsigned int to) const override {
+        for (unsigned int i = from; i < to; ++i) {
+            Hash::template hash<PwdLen>(pwd.data, hash);
+            reduceOne(hash, i, pwd);
+        }
+    }
+
+    void walkHash(unsigned char *hash, unsigned int from, unsigned int to) const override {
+        Password pwd;
+
+        for (unsigned int i = from; i < to; ++i) {
+            reduceOne(hash, i, pwd);
+            Hash::template hash<PwdLen>(pwd.data, hash);
+        }
+    }
+};
+
+/**
+ * Kernel of any other configuration, calling the hashing method of the table.
+ */
+class GenericChainKernel : public ChainKernel {
+
+private:
+    HashMethod *hashMethod;
+    Keyspace keyspace;
+    unsigned int reduction;
+    uint64_t offset;
+    unsigned char salt;
+
+    inline void reduceOne(unsigned char const *hash, unsigned int column, Password &pwd) const {
+        if (reduction == REDUCE_KEYSPACE)
+            Reduction::keyspace(hash, column, offset, keyspace, pwd);
+        else
+            Reduction::reduce<0, 0>(reduction, hash, column, offset, salt, keyspace.domain().data(),
+                                    keyspace.pwdLen(), keyspace.domain().size(), pwd);
+    }
+
+public:
+    GenericChainKernel(HashMethod *hashMethod, Keyspace const &keyspace, unsigned int chainLen,
+                       unsigned int tableIndex, unsigned int reduction)
+            : hashMethod(hashMethod), keyspace(keyspace), reduction(reduction),
+              offset((uint64_t) tableIndex * chainLen), salt(tableIndex) {}
+
+    bool specialized() const override {
+        return false;
+    }
+
+    void reduce(unsigned char const *hash, unsigned int column, Password &pwd) const override {
+        reduceOne(hash, column, pwd);
+    }
+
+    void reduceBatch(unsigned char const *hashes, unsigned int n, unsigned int column,
+                     Password *pwds) const override {
+        for (unsigned int j = 0; j < n; ++j)
+            reduceOne(hashes + j * HASH_SIZE, column, pwds[j]);
+    }
+
+    void hashBatch(Password const *pwds, unsigned int n, unsigned char *hashes) const override {
+        hashMethod->hashBatch(pwds, n, hashes);
+    }
+
+    void walk(Password &pwd, unsigned char *hash, unsigned int from, unsigned int to) const override {
+        for (unsigned int i = from; i < to; ++i) {
+            hashMethod->hash(pwd.data, pwd.len, hash);
+            reduceOne(hash, i, pwd);
+        }
+    }
+
+    void walkHash(unsigned char *hash, unsigned int from, unsigned int to) const override {
+        Password pwd;
+
+        for (unsigned int i = from; i < to; ++i) {
+            reduceOne(hash, i, pwd);
+            hashMethod->hash(pwd.data, pwd.len, hash);
+        }
+    }
+};
+
+/**
+ * @return the kernel of passwords of <pwdLen> characters of a domain of
+ * <DomainSize> characters, nullptr if it is not instantiated.
+ */
+template <class Hash, unsigned int Reduce, unsigned int DomainSize>
+static ChainKernel *createForDomain(unsigned int pwdLen, std::string const &domain, unsigned int chainLen,
+                                    unsigned int tableIndex) {
+    switch (pwdLen) {
+        case 1: return new FixedChainKernel<Hash, Reduce, 1, DomainSize>(domain, chainLen, tableIndex);
+        case 2: return new FixedChainKernel<Hash, Reduce, 2, DomainSize>(domain, chainLen, tableIndex);
+        case 3: return new FixedChainKernel<Hash, Reduce, 3, DomainSize>(domain, chainLen, tableIndex);
+        case 4: return new FixedChainKernel<Hash, Reduce, 4, DomainSize>(domain, chainLen, tableIndex);
+        case 5: return new FixedChainKernel<Hash, Reduce, 5, DomainSize>(domain, chainLen, tableIndex);
+        case 6: return new FixedChainKernel<Hash, Reduce, 6, DomainSize>(domain, chainLen, tableIndex);
+        case 7: return new FixedChainKernel<Hash, Reduce, 7, DomainSize>(domain, chainLen, tableIndex);
+        case 8: return new FixedChainKernel<Hash, Reduce, 8, DomainSize>(domain, chainLen, tableIndex);
+        default: return nullptr;
+    }
+}
+
+/**
+ * @return the kernel of a hashing method and a reduction function, nullptr
+ * if it is not instantiated.
+ */
+template <class Hash, unsigned int Reduce>
+static ChainKernel *createFixed(unsigned int pwdLen, std::string const &domain, unsigned int chainLen,
+                                unsigned int tableIndex) {
+    // Digits, lowercase, lowercase and digits, letters, letters and digits, printable ASCII.
+    switch (domain.size()) {
+        case 10: return createForDomain<Hash, Reduce, 10>(pwdLen, domain, chainLen, tableIndex);
+        case 26: return createForDomain<Hash, Reduce, 26>(pwdLen, domain, chainLen, tableIndex);
+        case 36: return createForDomain<Hash, Reduce, 36>(pwdLen, domain, chainLen, tableIndex);
+        case 52: return createForDomain<Hash, Reduce, 52>(pwdLen, domain, chainLen, tableIndex);
+        case 62: return createForDomain<Hash, Reduce, 62>(pwdLen, domain, chainLen, tableIndex);
+        case 95: return createForDomain<Hash, Reduce, 95>(pwdLen, domain, chainLen, tableIndex);
+        default: return nullptr;
+    }
+}
+
+/**
+ * @return the kernel of a hashing method, nullptr if it is not instantiated.
+ */
+template <class Hash>
+static ChainKernel *createFixed(unsigned int pwdLen, std::string const &domain, unsigned int chainLen,
+                                unsigned int tableIndex, unsigned int reduction) {
+    switch (reduction) {
+        case REDUCE_BYTES: return createFixed<Hash, REDUCE_BYTES>(pwdLen, domain, chainLen, tableIndex);
+        case REDUCE_INDEX: return createFixed<Hash, REDUCE_INDEX>(pwdLen, domain, chainLen, tableIndex);
+        default: return nullptr;
+    }
+}
+
+ChainKernel *ChainKernel::create(HashMethod *hashMethod, Keyspace const &keyspace, unsigned int chainLen,
+                                 unsigned int tableIndex, unsigned int reduction) {
+    ChainKernel *kernel = nullptr;
+    const unsigned int pwdLen = keyspace.pwdLen();
+    std::string const &domain = keyspace.domain();
+
+    // Passwords of several lengths or charsets are left to the generic kernel.
+    if (keyspace.uniform() && hashMethod) {
+        if (hashMethod->name() == "md5")
+            kernel = createFixed<MD5Kernel>(pwdLen, domain, chainLen, tableIndex, reduction);
+        else if (hashMethod->name() == "ntlm")
+            kernel = createFixed<NTLMKernel>(pwdLen, domain, chainLen, tableIndex, reduction);
+    }
+
+    if (!kernel)
+        kernel = new GenericChainKernel(hashMethod, keyspace, chainLen, tableIndex, reduction);
+
+    return kernel;
+}
@@ -0,0 +1,85 @@
+#ifndef RAINBOWHACKING_CHAINKERNEL_H
+#define RAINBOWHACKING_CHAINKERNEL_H
+
+#include <string>
+#include "HashMethod.hpp"
+#include "Keyspace.hpp"
+#include "Password.hpp"
+
+/**
+ * Chain walk of a table, hashing and reducing passwords column after column.
+ *
+ * The kernels of the common configurations are instantiated at build time,
+ * specialized on the hashing method (MD5 or NTLM), the reduction function,
+ * the password length and the size of the domain: their loops run with the
+ * hash inlined, the reduction unrolled and its modulo folded into a
+ * multiplication. Every
+ * other configuration, masks and length ranges included, falls back on a
+ * kernel calling the hashing method of the table.
+ *
+ * A kernel is picked once per table, so that the only indirect call is the
+ * one into the kernel, once per walk or per column of a batch.
+ */
+class ChainKernel {
+
+public:
+    virtual ~ChainKernel() = default;
+
+    /**
+     * Picks the kernel of a table.
+     * @param hashMethod: The hashing method, kept alive by the caller.
+     * @param keyspace: The passwords of the table.
+     * @param chainLen: The length of the chains.
+     * @param tableIndex: The index of the table in a set of tables.
+     * @param reduction: The reduction function, REDUCE_KEYSPACE if the keyspace is not uniform.
+     * @return A new kernel, owned by the caller.
+     */
+    static ChainKernel *create(HashMethod *hashMethod, Keyspace const &keyspace, unsigned int chainLen,
+                               unsigned int tableIndex, unsigned int reduction);
+
+    /**
+     * @return true if the kernel is specialized, false if it is the fallback one.
+     */
+    virtual bool specialized() const = 0;
+
+    /**
+     * Reduces a hash into a password, like RainbowTable::reduce().
+     * @param hash: The hash to reduce.
+     * @param column: The column of the hash in its chain.
+     * @param pwd: Placeholder for the password.
+     */
+    virtual void reduce(unsigned char const *hash, unsigned int column, Password &pwd) const = 0;
+
+    /**
+     * Reduces several hashes of the same column.
+     * @param hashes: The <n> hashes, one after another.
+     * @param n: Number of hashes.
+     * @param column: The column of the hashes.
+     * @param pwds: Placeholder for the n passwords.
+     */
+    virtual void reduceBatch(unsigned char const *hashes, unsigned int n, unsigned int column,
+                             Password *pwds) const = 0;
+
+    /**
+     * Hashes several passwords.
+     * @param pwds: The <n> passwords.
+     * @param n: Number of passwords.
+     * @param hashes: Placeholder for the n hashes, one after another.
+     */
+    virtual void hashBatch(Password const *pwds, unsigned int n, unsigned char *hashes) const = 0;
+
+    /**
+     * Hashes then reduces a password at columns <from> to <to> - 1.
+     * @param pwd: The password at column <from>. Replaced by the reduction of the last hash.
+     * @param hash: Placeholder for the last hash.
+     */
+    virtual void walk(Password &pwd, unsigned char *hash, unsigned int from, unsigned int to) const = 0;
+
+    /**
+     * Reduces then hashes a hash at columns <from> to <to> - 1.
+     * @param hash: The hash at column <from>. Replaced by the hash at column <to>.
+     */
+    virtual void walkHash(unsigned char *hash, unsigned int from, unsigned int to) const = 0;
+};
+
+#endif //RAINBOWHACKING_CHAINKERNEL_H
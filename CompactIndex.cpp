@@ -0,0 +1,124 @@
+#include "CompactIndex.h"
+#include "TableBuilder.hpp"
+#include <cassert>
+
+bool CompactIndex::canIndex(unsigned char const *starts, unsigned int n, Keyspace const &keyspace,
+                            unsigned int &bad) {
+    Password pwd{};
+    uint64_t index = 0;
+
+    for (unsigned int i = 0; i < n; ++i) {
+        pwd.load(starts + (size_t) i * keyspace.pwdLen(), keyspace.pwdLen());
+        if (!keyspace.rank(pwd, index)) {
+            bad = i;
+            return false;
+        }
+    }
+
+    return true;
+}
+
+CompactIndex::CompactIndex(Endpoint const *ends, unsigned char const *starts, unsigned int n,
+                           Keyspace const &keyspace, unsigned int suffixBits, unsigned int zeroBits,
+                           uint64_t startOffset)
+        : keyspace(keyspace) {
+    this->n = n;
+    this->zeroBits = zeroBits;
+    this->startOffset = startOffset;
+
+    // About 4 to 8 chains per bucket.
+    prefixBits = 1;
+    while (prefixBits < 32 && (n >> (prefixBits + 3)) > 0)
+        ++prefixBits;
+
+    if (suffixBits < 1)
+        suffixBits = 1;
+    if (suffixBits > 64 - zeroBits - prefixBits)
+        suffixBits = 64 - zeroBits - prefixBits;
+    this->suffixBits = suffixBits;
+
+    bucketStorage.assign(bucketCount(prefixBits), 0);
+    buckets = bucketStorage.data();
+    suffixes = BitArray(n, suffixBits);
+
+    // Start indices relative to the offset, as few bits as the largest of them needs.
+    std::vector<uint64_t> indices(n);
+    uint64_t largest = 0;
+    Password pwd{};
+    uint64_t index = startOffset;
+
+    for (unsigned int i = 0; i < n; ++i) {
+        pwd.load(starts + (size_t) i * keyspace.pwdLen(), keyspace.pwdLen());
+        // The caller has checked canIndex(): every start password has an index.
+        bool ranked = keyspace.rank(pwd, index);
+        assert(ranked);
+        (void) ranked;
+        indices[i] = index >= startOffset ? index - startOffset : index + (keyspace.size() - startOffset);
+        largest = indices[i] > largest ? indices[i] : largest;
+    }
+
+    unsigned int bits = 1;
+    while (bits < 64 && largest >> bits)
+        ++bits;
+    startIndices = BitArray(n, bits);
+
+    size_t last = 0;
+
+    for (unsigned int i = 0; i < n; ++i) {
+        // Chains are sorted, so buckets are filled one after another.
+        size_t b = bucket(ends[i]);
+        while (last < b)
+            bucketStorage[++last] = i;
+
+        suffixes.set(i, suffix(ends[i]));
+        startIndices.set(i, indices[i]);
+    }
+
+    while (last < bucketStorage.size() - 1)
+        bucketStorage[++last] = n;
+}
+
+CompactIndex::CompactIndex(unsigned int n, unsigned int prefixBits, unsigned int suffixBits,
+                           uint32_t const *buckets, uint64_t const *suffixes, uint64_t const *startIndices,
+                           Keyspace const &keyspace, unsigned int zeroBits, unsigned int startBits,
+                           uint64_t startOffset)
+        : suffixes(suffixes, n, suffixBits), startIndices(startIndices, n, startBits),
+          keyspace(keyspace) {
+    this->n = n;
+    this->zeroBits = zeroBits;
+    this->prefixBits = prefixBits;
+    this->suffixBits = suffixBits;
+    this->buckets = buckets;
+    this->startOffset = startOffset;
+}
+
+size_t CompactIndex::bucket(Endpoint const &end) const {
+    return (end.hi << zeroBits) >> (64 - prefixBits);
+}
+
+uint64_t CompactIndex::suffix(Endpoint const &end) const {
+    return (end.hi << (zeroBits + prefixBits)) >> (64 - suffixBits);
+}
+
+unsigned int CompactIndex::find(Endpoint const &end, size_t &first) const {
+    size_t b = bucket(end);
+    uint64_t s = suffix(end);
+
+    unsigned int i = buckets[b];
+    unsigned int last = buckets[b + 1];
+
+    // Buckets are small, and sorted by suffix.
+    while (i < last && suffixes.get(i) < s)
+        ++i;
+
+    first = i;
+
+    while (i < last && suffixes.get(i) == s)
+        ++i;
+
+    return i - first;
+}
+
+size_t CompactIndex::memoryUsage() const {
+    return bucketCount(prefixBits) * sizeof(uint32_t) + suffixes.memoryUsage() + startIndices.memoryUsage();
+}
@@ -0,0 +1,171 @@
+#ifndef RAINBOWHACKING_COMPACTINDEX_H
+#define RAINBOWHACKING_COMPACTINDEX_H
+
+#include <cstdint>
+#include <vector>
+#include "BitArray.hpp"
+#include "Keyspace.hpp"
+
+struct Endpoint;
+
+/**
+ * Compact form of a sorted table.
+ *
+ * Chains are grouped in buckets by the top bits of their end hash, so these
+ * bits are implied by the bucket and never stored. Only the next
+ * <suffixBits> bits of the end hash are kept, and start passwords are
+ * stored as their index in the keyspace, with as few bits as possible.
+ * Indices are stored relative to a start offset: the start passwords of a
+ * table derived from a counter are then small numbers, of a few bits.
+ *
+ * Truncated end hashes match more chains than the full ones would: these
+ * false matches are rejected when the chains are regenerated.
+ *
+ * The end hashes of a distinguished point table all start with <zeroBits>
+ * zero bits: these are skipped, so that buckets select on the bits after them.
+ */
+class CompactIndex {
+
+private:
+    unsigned int n;                 /* Number of chains */
+    unsigned int zeroBits;          /* Top bits of every end hash, known to be zero */
+    unsigned int prefixBits;        /* Bits of the end hash selecting the bucket */
+    unsigned int suffixBits;        /* Bits of the end hash stored after them */
+    std::vector<uint32_t> bucketStorage;
+    uint32_t const *buckets;        /* First chain of every bucket, plus the end */
+    BitArray suffixes;              /* Truncated end hashes */
+    BitArray startIndices;          /* Indices of the start passwords in the keyspace, minus the offset */
+    uint64_t startOffset;           /* Index in the keyspace of the start index 0, lower than its size */
+    Keyspace keyspace;
+
+    /**
+     * Bucket of an end hash.
+     */
+    inline size_t bucket(Endpoint const &end) const;
+
+    /**
+     * Truncated end hash.
+     */
+    inline uint64_t suffix(Endpoint const &end) const;
+
+public:
+    /**
+     * Checks that every start password of a table has an index in a keyspace.
+     * @param starts: The start passwords, <keyspace password length> bytes each.
+     * @param n: Number of chains.
+     * @param keyspace: The keyspace of the start passwords.
+     * @param bad: Placeholder for the first chain whose start password is not in the keyspace.
+     * @return false if a start password is not in the keyspace.
+     */
+    static bool canIndex(unsigned char const *starts, unsigned int n, Keyspace const &keyspace,
+                         unsigned int &bad);
+
+    /**
+     * Builds the index of a sorted table, whose start passwords pass canIndex().
+     * @param ends: The end hashes, sorted.
+     * @param starts: The start passwords, <keyspace password length> bytes each.
+     * @param n: Number of chains.
+     * @param keyspace: The keyspace of the start passwords.
+     * @param suffixBits: Bits of every end hash to keep after the bucket bits.
+     * @param zeroBits: Top bits of every end hash known to be zero, at most 32.
+     * @param startOffset: Index in the keyspace of the first start password of a counter.
+     */
+    CompactIndex(Endpoint const *ends, unsigned char const *starts, unsigned int n,
+                 Keyspace const &keyspace, unsigned int suffixBits, unsigned int zeroBits = 0,
+                 uint64_t startOffset = 0);
+
+    /**
+     * Read-only view constructor, over arrays kept alive by the caller.
+     * @param n: Number of chains.
+     * @param prefixBits: Bits of the end hash selecting the bucket.
+     * @param suffixBits: Bits of the end hash stored after them.
+     * @param buckets: The bucketCount(prefixBits) bucket offsets.
+     * @param suffixes: The words of the truncated end hashes.
+     * @param startIndices: The words of the start password indices, of <startBits> bits each.
+     * @param keyspace: The keyspace of the start passwords.
+     * @param zeroBits: Top bits of every end hash known to be zero.
+     * @param startBits: Bits of every start password index.
+     * @param startOffset: Index in the keyspace of the start index 0, lower than its size.
+     */
+    CompactIndex(unsigned int n, unsigned int prefixBits, unsigned int suffixBits,
+                 uint32_t const *buckets, uint64_t const *suffixes, uint64_t const *startIndices,
+                 Keyspace const &keyspace, unsigned int zeroBits, unsigned int startBits, uint64_t startOffset);
+
+    /**
+     * @return the number of bucket offsets for <prefixBits> bits.
+     */
+    static size_t bucketCount(unsigned int prefixBits) {
+        return ((size_t) 1 << prefixBits) + 1;
+    }
+
+    /**
+     * @return the bits stored per start password for a keyspace, at most.
+     */
+    static unsigned int startBits(Keyspace const &keyspace) {
+        return keyspace.bits() > 0 ? keyspace.bits() : 1;
+    }
+
+    /**
+     * @return the bits stored per start password.
+     */
+    unsigned int getStartBits() const {
+        return startIndices.getWidth();
+    }
+
+    unsigned int size() const {
+        return n;
+    }
+
+    unsigned int getPrefixBits() const {
+        return prefixBits;
+    }
+
+    unsigned int getZeroBits() const {
+        return zeroBits;
+    }
+
+    uint32_t const *getBuckets() const {
+        return buckets;
+    }
+
+    BitArray const &getSuffixes() const {
+        return suffixes;
+    }
+
+    BitArray const &getStartIndices() const {
+        return startIndices;
+    }
+
+    /**
+     * @return the number of end hash bits stored per chain.
+     */
+    unsigned int getSuffixBits() const {
+        return suffixBits;
+    }
+
+    /**
+     * Finds the chains whose truncated end hash matches.
+     * @param end: The end hash.
+     * @param first: Placeholder for the index of the first chain found.
+     * @return The number of chains found.
+     */
+    unsigned int find(Endpoint const &end, size_t &first) const;
+
+    /**
+     * Start password getter
+     * @param i: Index of the chain.
+     * @param pwd: Placeholder for the password.
+     */
+    void getStart(unsigned int i, Password &pwd) const {
+        uint64_t index = startIndices.get(i);
+        keyspace.unrank(index < keyspace.size() - startOffset ? index + startOffset
+                                                             : index - (keyspace.size() - startOffset), pwd);
+    }
+
+    /**
+     * @return the memory used, in bytes.
+     */
+    size_t memoryUsage() const;
+};
+
+#endif //RAINBOWHACKING_COMPACTINDEX_H
@@ -0,0 +1,482 @@
+#include "ExternalTableBuilder.h"
+#include <fstream>
+#include <iostream>
+#include <queue>
+#include <functional>
+#include <cstdio>
+#include <climits>
+
+/**
+ * Reads the records of a run through a bounded buffer.
+ */
+struct RunReader {
+    std::ifstream in;
+    std::vector<unsigned char> buffer;
+    size_t recordSize;
+    size_t pos;     /* Offset of the current record in the buffer */
+    size_t end;     /* End of the records in the buffer */
+    size_t left;    /* Records not read from the file yet */
+
+    RunReader(std::string const &path, size_t nRecords, size_t recordSize, size_t bufferSize)
+            : in(path.c_str(), std::ios::binary), recordSize(recordSize), pos(0), end(0), left(nRecords) {
+        size_t records = bufferSize / recordSize > 0 ? bufferSize / recordSize : 1;
+        buffer.resize(records * recordSize);
+    }
+
+    /**
+     * Moves to the next record, reading the next block of the run if needed.
+     * @return false at the end of the run, or on error.
+     */
+    bool advance() {
+        pos += recordSize;
+
+        if (pos < end)
+            return true;
+
+        size_t records = buffer.size() / recordSize < left ? buffer.size() / recordSize : left;
+        if (records == 0 || !in.read(reinterpret_cast<char *>(buffer.data()), records * recordSize))
+            return false;
+
+        left -= records;
+        pos = 0;
+        end = records * recordSize;
+        return true;
+    }
+
+    unsigned char const *record() const {
+        return &buffer[pos];
+    }
+
+    Endpoint endpoint() const {
+        Endpoint e{};
+        memcpy(&e, record(), sizeof(Endpoint));
+        return e;
+    }
+};
+
+/* Smallest end hash first, the earliest run first among equal ones. */
+struct RunHead {
+    Endpoint end;
+    unsigned int run;
+
+    bool operator>(RunHead const &other) const {
+        return other.end < end || (end == other.end && run > other.run);
+    }
+};
+
+ExternalTableBuilder::ExternalTableBuilder(std::string const &filePath, TableFileHeader const &header,
+                                           size_t budget, bool dedup, bool directory) : header(header) {
+    this->filePath = filePath;
+    this->pwdLen = header.pwdLen;
+    this->nChecks = header.nCheckpoints;
+    this->budget = budget;
+    this->dedup = dedup;
+    this->directory = directory;
+}
+
+ExternalTableBuilder::~ExternalTableBuilder() {
+    removeRuns();
+}
+
+size_t ExternalTableBuilder::runChains() const {
+    // Building a run takes about 3 times its size, sorting included, plus
+    // the start passwords of distinguished point chains before they are gathered.
+    size_t chains = budget / (3 * recordSize() + sizeof(Password));
+
+    if (chains < 1)
+        return 1;
+    return chains < UINT_MAX ? (unsigned int) chains : UINT_MAX;
+}
+
+bool ExternalTableBuilder::addRun(Table const &run) {
+    std::string path = filePath + ".run" + std::to_string(runs.size());
+    std::ofstream out(path.c_str(), std::ios::binary | std::ios::trunc);
+
+    runs.push_back(path);
+    runSizes.push_back(run.size());
+
+    Endpoint const *ends = run.endData();
+    unsigned char const *starts = run.startData();
+    std::vector<unsigned char> block(EXTERNAL_MIN_BUFFER / recordSize() * recordSize());
+    const size_t blockRecords = block.size() / recordSize();
+
+    for (size_t first = 0; first < run.size() && out; first += blockRecords) {
+        size_t n = run.size() - first < blockRecords ? run.size() - first : blockRecords;
+        unsigned char *record = block.data();
+
+        for (size_t i = first; i < first + n; ++i) {
+            memcpy(record, &ends[i], sizeof(Endpoint));
+            memcpy(record + sizeof(Endpoint), starts + i * pwdLen, pwdLen);
+            if (nChecks > 0) {
+                uint64_t checks = run.getChecks(i);
+                memcpy(record + sizeof(Endpoint) + pwdLen, &checks, sizeof(uint64_t));
+            }
+            record += recordSize();
+        }
+
+        out.write(reinterpret_cast<char const *>(block.data()), n * recordSize());
+    }
+
+    out.close();
+
+    if (!out) {
+        std::cerr << "Could not write to file \"" << path << "\"." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+long ExternalTableBuilder::countChains() const {
+    long n = 0;
+
+    if (!dedup) {
+        for (size_t size : runSizes)
+            n += size;
+        return n;
+    }
+
+    size_t runBuffer = budget / 2 / (runs.size() > 0 ? runs.size() : 1);
+    if (runBuffer < EXTERNAL_MIN_BUFFER)
+        runBuffer = EXTERNAL_MIN_BUFFER;
+
+    std::vector<RunReader *> readers;
+    std::priority_queue<RunHead, std::vector<RunHead>, std::greater<RunHead>> heads;
+
+    for (unsigned int r = 0; r < runs.size(); ++r) {
+        readers.push_back(new RunReader(runs[r], runSizes[r], recordSize(), runBuffer));
+
+        if (readers[r]->advance())
+            heads.push({readers[r]->endpoint(), r});
+    }
+
+    Endpoint last{};
+
+    while (!heads.empty()) {
+        RunHead head = heads.top();
+        heads.pop();
+
+        if (n == 0 || head.end != last) {
+            last = head.end;
+            ++n;
+        }
+
+        if (readers[head.run]->advance())
+            heads.push({readers[head.run]->endpoint(), head.run});
+    }
+
+    bool ok = true;
+
+    for (RunReader *reader : readers) {
+        ok = ok && !reader->in.bad() && reader->left == 0;
+        delete reader;
+    }
+
+    if (!ok) {
+        std::cerr << "Could not read the runs of \"" << filePath << "\"." << std::endl;
+        return -1;
+    }
+
+    return n;
+}
+
+long ExternalTableBuilder::mergeRuns(std::ofstream &out, Checksum &endsSum,
+                                     std::string const &startsPath, std::string const &checksPath) {
+    std::ofstream startsOut(startsPath.c_str(), std::ios::binary | std::ios::trunc);
+    std::ofstream checksOut;
+
+    if (nChecks > 0)
+        checksOut.open(checksPath.c_str(), std::ios::binary | std::ios::trunc);
+
+    // Half of the budget reads the runs, a quarter buffers the end hashes written.
+    size_t runBuffer = budget / 2 / (runs.size() > 0 ? runs.size() : 1);
+    if (runBuffer < EXTERNAL_MIN_BUFFER)
+        runBuffer = EXTERNAL_MIN_BUFFER;
+
+    size_t outChains = budget / 4 / sizeof(Endpoint);
+    if (outChains < EXTERNAL_MIN_BUFFER / sizeof(Endpoint))
+        outChains = EXTERNAL_MIN_BUFFER / sizeof(Endpoint);
+
+    std::vector<RunReader *> readers;
+    std::priority_queue<RunHead, std::vector<RunHead>, std::greater<RunHead>> heads;
+
+    for (unsigned int r = 0; r < runs.size(); ++r) {
+        readers.push_back(new RunReader(runs[r], runSizes[r], recordSize(), runBuffer));
+
+        // The first advance() reads the first block.
+        if (readers[r]->advance())
+            heads.push({readers[r]->endpoint(), r});
+    }
+
+    std::vector<Endpoint> ends;
+    ends.reserve(outChains);
+
+    const uint64_t mask = nChecks < 64 ? ((uint64_t) 1 << nChecks) - 1 : ~(uint64_t) 0;
+    uint64_t acc = 0, check;
+    unsigned int accBits = 0;
+    size_t nWords = 0;
+
+    long n = 0;
+    Endpoint last{};
+
+    while (!heads.empty()) {
+        RunHead head = heads.top();
+        heads.pop();
+
+        RunReader *reader = readers[head.run];
+        unsigned char const *record = reader->record();
+
+        // Runs of equal end hashes are contiguous: keep the first one only.
+        if (!dedup || n == 0 || head.end != last) {
+            ends.push_back(head.end);
+            startsOut.write(reinterpret_cast<char const *>(record + sizeof(Endpoint)), pwdLen);
+
+            if (nChecks > 0) {
+                // Packed as a BitArray of <nChecks> bits per chain.
+                memcpy(&check, record + sizeof(Endpoint) + pwdLen, sizeof(uint64_t));
+                check &= mask;
+                acc |= check << accBits;
+
+                if (accBits + nChecks >= 64) {
+                    checksOut.write(reinterpret_cast<char const *>(&acc), sizeof(acc));
+                    ++nWords;
+                    acc = accBits > 0 ? check >> (64 - accBits) : 0;
+                    accBits = accBits + nChecks - 64;
+                } else {
+                    accBits += nChecks;
+                }
+            }
+
+            if (ends.size() == outChains) {
+                out.write(reinterpret_cast<char const *>(ends.data()), ends.size() * sizeof(Endpoint));
+                endsSum.update(ends.data(), ends.size() * sizeof(Endpoint));
+                ends.clear();
+            }
+
+            last = head.end;
+            ++n;
+        }
+
+        if (reader->advance())
+            heads.push({reader->endpoint(), head.run});
+    }
+
+    out.write(reinterpret_cast<char const *>(ends.data()), ends.size() * sizeof(Endpoint));
+    endsSum.update(ends.data(), ends.size() * sizeof(Endpoint));
+
+    if (nChecks > 0) {
+        if (accBits > 0) {
+            checksOut.write(reinterpret_cast<char const *>(&acc), sizeof(acc));
+            ++nWords;
+        }
+
+        acc = 0;
+        for (; nWords < BitArray::wordCount(n, nChecks); ++nWords)
+            checksOut.write(reinterpret_cast<char const *>(&acc), sizeof(acc));
+    }
+
+    bool ok = true;
+
+    for (RunReader *reader : readers) {
+        ok = ok && !reader->in.bad() && reader->left == 0;
+        delete reader;
+    }
+
+    startsOut.close();
+    checksOut.close();
+
+    if (!ok || !startsOut || (nChecks > 0 && !checksOut)) {
+        std::cerr << "Could not merge the runs of \"" << filePath << "\"." << std::endl;
+        return -1;
+    }
+
+    return n;
+}
+
+bool ExternalTableBuilder::appendSection(std::ofstream &out, uint32_t type, std::string const &path) {
+    std::ifstream in(path.c_str(), std::ios::binary);
+    std::vector<char> block(budget / 4 > EXTERNAL_MIN_BUFFER ? budget / 4 : EXTERNAL_MIN_BUFFER);
+    Checksum sum;
+
+    TableFile::beginSection(out, header, type);
+
+    while (in) {
+        in.read(block.data(), block.size());
+        out.write(block.data(), in.gcount());
+        sum.update(block.data(), in.gcount());
+    }
+
+    TableFile::endSection(out, header, sum.digest());
+
+    return !in.bad() && out;
+}
+
+bool ExternalTableBuilder::appendFilter(std::ofstream &out, TableSection const &ends, size_t n) {
+    const size_t nBlocks = BloomFilter::blockCount(n, header.filterBits);
+    const size_t blockBytes = BLOOM_BLOCK_WORDS * sizeof(uint64_t);
+
+    // Half of the budget holds blocks of the filter, a quarter buffers the end hashes read.
+    size_t windowBlocks = budget / 2 / blockBytes;
+    if (windowBlocks < EXTERNAL_MIN_BUFFER / blockBytes)
+        windowBlocks = EXTERNAL_MIN_BUFFER / blockBytes;
+
+    size_t readChains = budget / 4 / sizeof(Endpoint);
+    if (readChains < EXTERNAL_MIN_BUFFER / sizeof(Endpoint))
+        readChains = EXTERNAL_MIN_BUFFER / sizeof(Endpoint);
+
+    out.flush();
+    std::ifstream in(filePath.c_str(), std::ios::binary);
+    std::vector<uint64_t> blocks;
+    std::vector<Endpoint> buffer(readChains);
+    Checksum sum;
+
+    TableFile::beginSection(out, header, SECTION_FILTER);
+
+    // Every range of blocks reads all the end hashes again: a single pass,
+    // unless the filter is larger than the budget.
+    for (size_t first = 0; first < nBlocks && in && out; first += windowBlocks) {
+        size_t count = nBlocks - first < windowBlocks ? nBlocks - first : windowBlocks;
+        blocks.assign(count * BLOOM_BLOCK_WORDS, 0);
+
+        in.clear();
+        in.seekg(ends.offset);
+
+        for (size_t left = n; left > 0 && in;) {
+            size_t chains = left < readChains ? left : readChains;
+            in.read(reinterpret_cast<char *>(buffer.data()), chains * sizeof(Endpoint));
+
+            for (size_t i = 0; i < chains; ++i) {
+                size_t b = BloomFilter::blockIndex(buffer[i].lo, nBlocks);
+                if (b >= first && b < first + count)
+                    BloomFilter::addToBlock(&blocks[(b - first) * BLOOM_BLOCK_WORDS], buffer[i].hi);
+            }
+
+            left -= chains;
+        }
+
+        out.write(reinterpret_cast<char const *>(blocks.data()), count * blockBytes);
+        sum.update(blocks.data(), count * blockBytes);
+    }
+
+    TableFile::endSection(out, header, sum.digest());
+
+    return (bool) in && out;
+}
+
+bool ExternalTableBuilder::appendDirectory(std::ofstream &out, TableSection const &ends, size_t n) {
+    const unsigned int bits = BucketDirectory::defaultBits(n, header.directoryZeroBits);
+    const size_t nEntries = BucketDirectory::entryCount(bits);
+
+    size_t bufferSize = budget / 4 / sizeof(Endpoint);
+    if (bufferSize < EXTERNAL_MIN_BUFFER / sizeof(Endpoint))
+        bufferSize = EXTERNAL_MIN_BUFFER / sizeof(Endpoint);
+
+    out.flush();
+    std::ifstream in(filePath.c_str(), std::ios::binary);
+    std::vector<Endpoint> buffer(bufferSize);
+    std::vector<uint64_t> offsets;
+    offsets.reserve(bufferSize);
+    Checksum sum;
+
+    auto flush = [&]() {
+        out.write(reinterpret_cast<char const *>(offsets.data()), offsets.size() * sizeof(uint64_t));
+        sum.update(offsets.data(), offsets.size() * sizeof(uint64_t));
+        offsets.clear();
+    };
+
+    in.seekg(ends.offset);
+    TableFile::beginSection(out, header, SECTION_DIRECTORY);
+
+    // Same offsets as BucketDirectory::add(), written as they are known.
+    size_t next = 0, i = 0;
+
+    while (i < n && in && out) {
+        size_t chains = n - i < bufferSize ? n - i : bufferSize;
+        in.read(reinterpret_cast<char *>(buffer.data()), chains * sizeof(Endpoint));
+
+        for (size_t j = 0; j < chains; ++j, ++i) {
+            size_t b = BucketDirectory::bucket(buffer[j].hi, bits, header.directoryZeroBits);
+
+            for (; next <= b; ++next) {
+                offsets.push_back(i);
+                if (offsets.size() == bufferSize)
+                    flush();
+            }
+        }
+    }
+
+    for (; next < nEntries && out; ++next) {
+        offsets.push_back(n);
+        if (offsets.size() == bufferSize)
+            flush();
+    }
+
+    flush();
+    TableFile::endSection(out, header, sum.digest());
+    header.directoryBits = bits;
+
+    return (bool) in && out;
+}
+
+void ExternalTableBuilder::removeRuns() {
+    for (std::string const &run : runs)
+        std::remove(run.c_str());
+
+    runs.clear();
+    runSizes.clear();
+}
+
+long ExternalTableBuilder::finish() {
+    std::ofstream out(filePath.c_str(), std::ios::binary | std::ios::trunc);
+
+    if (!out) {
+        std::cerr << "Could not write to file \"" << filePath << "\"." << std::endl;
+        return -1;
+    }
+
+    header.compactPrefixBits = 0;
+    header.compactSuffixBits = 0;
+    header.compactZeroBits = 0;
+    header.compactStartBits = 0;
+    // Set by appendDirectory() to the bits of the directory, if any.
+    header.directoryBits = 0;
+    header.nSections = 0;
+    memset(header.sections, 0, sizeof(header.sections));
+
+    // The header is written last, once the sections are known.
+    TableFileHeader placeholder{};
+    out.write(reinterpret_cast<char const *>(&placeholder), sizeof(placeholder));
+
+    const std::string startsPath = filePath + ".starts";
+    const std::string checksPath = filePath + ".checks";
+    Checksum endsSum;
+
+    TableFile::beginSection(out, header, SECTION_ENDS);
+    long n = mergeRuns(out, endsSum, startsPath, checksPath);
+    TableFile::endSection(out, header, endsSum.digest());
+
+    removeRuns();
+
+    bool ok = n >= 0 && appendSection(out, SECTION_STARTS, startsPath);
+    if (nChecks > 0)
+        ok = ok && appendSection(out, SECTION_CHECKPOINTS, checksPath);
+    if (header.filterBits > 0)
+        ok = ok && appendFilter(out, header.sections[0], n);
+    if (directory)
+        ok = ok && appendDirectory(out, header.sections[0], n);
+
+    header.nChains = n >= 0 ? n : 0;
+    header.nChains32 = 0;
+    ok = TableFile::writeHeader(out, header) && ok;
+    out.close();
+
+    std::remove(startsPath.c_str());
+    std::remove(checksPath.c_str());
+
+    if (!ok || !out) {
+        std::cerr << "Could not write to file \"" << filePath << "\"." << std::endl;
+        return -1;
+    }
+
+    return n;
+}
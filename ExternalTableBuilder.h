@@ -0,0 +1,129 @@
+#ifndef RAINBOWHACKING_EXTERNALTABLEBUILDER_H
+#define RAINBOWHACKING_EXTERNALTABLEBUILDER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "TableBuilder.hpp"
+#include "TableFile.h"
+
+#define EXTERNAL_MIN_BUFFER (1u << 16)              /* Smallest read buffer of a run while merging */
+#define EXTERNAL_DEFAULT_BUDGET ((size_t) 1 << 30)  /* Memory of a build, unless set otherwise */
+
+/**
+ * Builds a binary table file too large to be sorted in memory.
+ *
+ * Chains are generated a run at a time, each run small enough to be built
+ * within the memory budget. Every sorted run is spilled to a temporary file,
+ * then all of them are merged into the table file, reading every run
+ * through a bounded buffer. The end hashes are written to the table file
+ * as they are merged; the start passwords and checkpoint bits go to
+ * temporary files, appended as the next sections afterwards. The filter
+ * and the directory of the end hashes, if any, are built last from the end
+ * hashes written.
+ */
+class ExternalTableBuilder {
+
+private:
+    std::string filePath;           /* Table file to write */
+    TableFileHeader header;         /* Parameters of the table */
+    unsigned int pwdLen;
+    unsigned int nChecks;           /* Checkpoint bits per chain, 0 if none */
+    size_t budget;                  /* Memory to stay within, in bytes */
+    bool dedup;                     /* Whether to keep a single chain per end hash */
+    bool directory;                 /* Whether to append a directory of the end hashes */
+    std::vector<std::string> runs;  /* Sorted runs spilled so far */
+    std::vector<size_t> runSizes;   /* Number of chains of every run */
+
+    /**
+     * @return the bytes of a chain in a run file.
+     */
+    size_t recordSize() const {
+        return sizeof(Endpoint) + pwdLen + (nChecks > 0 ? sizeof(uint64_t) : 0);
+    }
+
+    /**
+     * Merges the runs, writing the end hashes to <out> and the rest to the temporary files.
+     * @param endsSum: Checksum of the end hashes written.
+     * @return the number of chains written, or -1 on error.
+     */
+    long mergeRuns(std::ofstream &out, Checksum &endsSum, std::string const &startsPath, std::string const &checksPath);
+
+    /**
+     * Appends a temporary file to the table file as a section.
+     */
+    bool appendSection(std::ofstream &out, uint32_t type, std::string const &path);
+
+    /**
+     * Appends the filter over the <n> end hashes already written to the
+     * table file, filling a range of its blocks at a time within the budget.
+     */
+    bool appendFilter(std::ofstream &out, TableSection const &ends, size_t n);
+
+    /**
+     * Appends the bucket directory of the <n> end hashes already written to
+     * the table file, streaming its offsets as the end hashes are read.
+     */
+    bool appendDirectory(std::ofstream &out, TableSection const &ends, size_t n);
+
+    /**
+     * Removes the temporary files.
+     */
+    void removeRuns();
+
+public:
+    /**
+     * Constructor
+     * @param filePath: The path of the table file to write.
+     * @param header: The parameters of the table, as given to TableFile::write().
+     * @param budget: Memory to stay within, in bytes.
+     * @param dedup: true to keep a single chain per end hash, when merging.
+     * @param directory: true to append a directory sized from the number of chains.
+     */
+    ExternalTableBuilder(std::string const &filePath, TableFileHeader const &header, size_t budget, bool dedup,
+                         bool directory);
+
+    /**
+     * Destructor. Removes the runs left, if finish() has not been called.
+     */
+    ~ExternalTableBuilder();
+
+    ExternalTableBuilder(ExternalTableBuilder const &) = delete;
+    ExternalTableBuilder &operator=(ExternalTableBuilder const &) = delete;
+
+    /**
+     * @return the number of chains of a run which can be generated and
+     * sorted within the budget, about 3 times their size, and at most
+     * UINT_MAX as a run is built in memory.
+     */
+    size_t runChains() const;
+
+    /**
+     * Records the start passwords used by the runs, when they come from a counter.
+     * @param startCount: The number of start indices used.
+     */
+    void setStartCount(uint64_t startCount) {
+        header.startCount = startCount;
+    }
+
+    /**
+     * Spills a run to a temporary file.
+     * @param run: A sorted table, of owned arrays.
+     * @return true if the run has been written.
+     */
+    bool addRun(Table const &run);
+
+    /**
+     * Merges the end hashes of the runs, without writing anything.
+     * @return the number of chains finish() would write, or -1 on error.
+     */
+    long countChains() const;
+
+    /**
+     * Merges all the runs into the table file.
+     * @return the number of chains of the table, or -1 on error.
+     */
+    long finish();
+};
+
+#endif //RAINBOWHACKING_EXTERNALTABLEBUILDER_H
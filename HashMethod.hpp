@@ -6,76 +6,147 @@
 #define RAINBOWHACKING_HASHMETHOD_HPP
 
 #include "openssl/md5.h"
+#include "openssl/sha.h"
+#include "MD5Multi.h"
+#include "MD5Block.hpp"
+#include "MD4Block.hpp"
+#include "SHA1Block.hpp"
+#include "SHA256Block.hpp"
+#include "Password.hpp"
 #include <cstring>
 #include <string>
 #include <utility>
+#include <vector>
 
-#define HASH_SIZE 16
+#define HASH_SIZE 16         /* Bytes of a digest along the chains and in the tables, the first ones */
+#define MAX_DIGEST_SIZE 32   /* Largest digest of a hashing method */
+
+/**
+ * Hash to crack, prepared once by the hashing method so that candidate
+ * passwords can be compared to it quickly.
+ */
+struct HashTarget {
+    unsigned char hash[HASH_SIZE];  /* The hash itself */
+    unsigned int pwdLen;            /* Length of the candidate passwords */
+    uint32_t state[4];              /* Specific to the hashing method */
+};
 
 /**
  * Hashing method interface
+ *
+ * Chains and tables only keep the first HASH_SIZE bytes of the digests,
+ * which the reduction reads and the end hashes are sorted on: that is the
+ * hash of a password. Digests longer than HASH_SIZE bytes are only read in
+ * full from the user, and shown back.
  */
 class HashMethod {
 
 protected:
     std::string _name;
+    unsigned int _digestSize;
     /**
      * Constructor
      * @param name: Name of the method
+     * @param digestSize: Size of its digests, from HASH_SIZE to MAX_DIGEST_SIZE bytes.
      */
-    explicit HashMethod(std::string name) : _name(std::move(name)) {};
+    HashMethod(std::string name, unsigned int digestSize) : _name(std::move(name)), _digestSize(digestSize) {};
 
 public:
 
     virtual ~HashMethod() = default;;
 
     /**
-     *
-     * @param pwd
-     * @param hash
+     * Creates a hashing method from its name.
+     * @param name: One of the names listed by names().
+     * @return A new hashing method, owned by the caller, or nullptr if no method has that name.
      */
-    virtual void hash(std::string const &pwd, unsigned char *hash) const = 0;
+    static HashMethod *create(std::string const &name);
+
+    /**
+     * @return the names of the hashing methods, separated by spaces.
+     */
+    static std::string names();
 
     /**
      *
-     * @return the name of the hash method
+     * @param pwd: The password bytes.
+     * @param len: The length of the password.
+     * @param hash: Placeholder for the first HASH_SIZE bytes of the digest.
      */
-    inline std::string name() {
-        return _name;
+    virtual void hash(unsigned char const *pwd, unsigned int len, unsigned char *hash) const = 0;
+
+    /**
+     * Computes the whole digest of a password.
+     * @param pwd: The password bytes.
+     * @param len: The length of the password.
+     * @param digest: Placeholder for the digestSize() bytes of the digest.
+     */
+    virtual void digest(unsigned char const *pwd, unsigned int len, unsigned char *digest) const {
+        hash(pwd, len, digest);
     }
-};
 
-/**
- * MD5 hashing method
- */
+    /**
+     * Hashes several passwords.
+     * @param pwds: The passwords.
+     * @param n: Number of passwords.
+     * @param hashes: Placeholder for the n hashes, stored one after another.
+     */
+    virtual void hashBatch(Password const *pwds, unsigned int n, unsigned char *hashes) const {
+        for (unsigned int i = 0; i < n; ++i)
+            hash(pwds[i].data, pwds[i].len, hashes + i * HASH_SIZE);
+    }
 
-class MD5Hash : public HashMethod {
+    /**
+     * Prepares a hash to be compared to many passwords.
+     * @param hash: The hash.
+     * @param pwdLen: The length of the passwords it will be compared to.
+     * @param target: Placeholder for the prepared hash.
+     */
+    virtual void prepareTarget(unsigned char const *hash, unsigned int pwdLen, HashTarget &target) const {
+        memcpy(target.hash, hash, HASH_SIZE);
+        target.pwdLen = pwdLen;
+    }
 
-public:
     /**
-     * Constructor
+     * Checks whether a password hashes to a prepared hash.
+     * @param pwd: The password.
+     * @param target: The prepared hash.
+     * @return true if the password hashes to the target.
      */
-    MD5Hash() : HashMethod("md5") {};
+    virtual bool matches(Password const &pwd, HashTarget const &target) const {
+        unsigned char h[HASH_SIZE];
 
-    ~MD5Hash() override = default;
+        hash(pwd.data, pwd.len, h);
 
-    void hash(std::string const &pwd, unsigned char *hash) const override {
+        return memcmp(h, target.hash, HASH_SIZE) == 0;
+    }
 
-        auto d = reinterpret_cast<const unsigned char *>(pwd.c_str());
+    /**
+     *
+     * @return the name of the hash method
+     */
+    inline std::string name() const {
+        return _name;
+    }
 
-        MD5(d, pwd.size(), hash);
+    /**
+     * @return the size of a whole digest, in bytes.
+     */
+    inline unsigned int digestSize() const {
+        return _digestSize;
     }
 
     /**
      * Convert char pointer to hex string
-     * @param hash
+     * @param hash: The bytes.
+     * @param size: Number of bytes.
      * @return
      */
-    static std::string convertHexString(unsigned char const *hash) {
+    static std::string convertHexString(unsigned char const *hash, unsigned int size = HASH_SIZE) {
         std::string hex = "0123456789ABCDEF";
         std::string hashStr;
 
-        for (int i = 0; i < HASH_SIZE; ++i) {
+        for (unsigned int i = 0; i < size; ++i) {
             hashStr += hex[hash[i] >> 4u];
             hashStr += hex[hash[i] & 15u];
         }
@@ -85,23 +156,177 @@ public:
 
     /**
      * Convert hex string to char array
-     * @param text
-     * @param hash
+     * @param text: At least 2 * <size> hexadecimal digits.
+     * @param hash: Placeholder for the bytes.
+     * @param size: Number of bytes.
      */
-    static void hexConvert(char const *text, unsigned char *hash) {
+    static void hexConvert(char const *text, unsigned char *hash, unsigned int size = HASH_SIZE) {
 
-        // WARNING: Current implementation specific to MD5.
-        // Transform the hash (string) into a byte array.
         // Since every byte is exressed with 2 chars, read it 2 by 2,
         // convert it to an int and store it into the bytes array.
 
         char buff[] = "00";
 
-        for (int i = 0; i < HASH_SIZE; ++i) {
+        for (unsigned int i = 0; i < size; ++i) {
             strncpy(buff, text + 2 * i, 2);
             hash[i] = strtoul(buff, nullptr, 16);
         }
     }
 };
 
+/**
+ * MD5 hashing method
+ */
+
+class MD5Hash : public HashMethod {
+
+private:
+    /* Single block hashing, for every password length that fits in a block */
+    std::vector<MD5Block> _blocks;
+
+public:
+    /**
+     * Constructor
+     */
+    MD5Hash() : HashMethod("md5", 16) {
+        _blocks.reserve(MD5Block::MAX_LEN + 1);
+        for (unsigned int len = 0; len <= MD5Block::MAX_LEN; ++len)
+            _blocks.emplace_back(len);
+    };
+
+    ~MD5Hash() override = default;
+
+    void hash(unsigned char const *pwd, unsigned int len, unsigned char *hash) const override {
+
+        if (len <= MD5Block::MAX_LEN)
+            _blocks[len].hash(pwd, hash);
+        else
+            MD5(pwd, len, hash);
+    }
+
+    void hashBatch(Password const *pwds, unsigned int n, unsigned char *hashes) const override {
+        // Hashes the passwords in lockstep, one per SIMD lane.
+        MD5Multi::hash(pwds, n, hashes);
+    }
+
+    void prepareTarget(unsigned char const *hash, unsigned int pwdLen, HashTarget &target) const override {
+        HashMethod::prepareTarget(hash, pwdLen, target);
+
+        if (pwdLen <= MD5Block::MAX_LEN)
+            _blocks[pwdLen].prepare(hash, target.state);
+    }
+
+    bool matches(Password const &pwd, HashTarget const &target) const override {
+        if (pwd.len == target.pwdLen)
+            return _blocks[pwd.len].matches(pwd.data, target.state);
+
+        return HashMethod::matches(pwd, target);
+    }
+};
+
+/**
+ * NTLM hashing method: MD4 of the UTF-16LE encoding of the password.
+ */
+class NTLMHash : public HashMethod {
+
+public:
+    NTLMHash() : HashMethod("ntlm", 16) {}
+
+    ~NTLMHash() override = default;
+
+    void hash(unsigned char const *pwd, unsigned int len, unsigned char *hash) const override {
+        if (len <= MD4Block::MAX_NTLM_LEN)
+            MD4Block::ntlm(pwd, len, hash);
+        else
+            MD4Block::ntlmLong(pwd, len, hash);
+    }
+
+    void hashBatch(Password const *pwds, unsigned int n, unsigned char *hashes) const override {
+        for (unsigned int i = 0; i < n; ++i) {
+            if (pwds[i].len > MD4Block::MAX_NTLM_LEN) {
+                HashMethod::hashBatch(pwds, n, hashes);
+                return;
+            }
+        }
+
+        // Hashes the passwords in lockstep, one per SIMD lane.
+        MD5Multi::ntlm(pwds, n, hashes);
+    }
+};
+
+/**
+ * SHA-1 hashing method
+ */
+class SHA1Hash : public HashMethod {
+
+public:
+    SHA1Hash() : HashMethod("sha1", SHA1Block::DIGEST_SIZE) {}
+
+    ~SHA1Hash() override = default;
+
+    void hash(unsigned char const *pwd, unsigned int len, unsigned char *hash) const override {
+        if (len <= SHA1Block::MAX_LEN) {
+            SHA1Block::hash(pwd, len, hash, HASH_SIZE);
+            return;
+        }
+
+        unsigned char whole[SHA1Block::DIGEST_SIZE];
+        SHA1(pwd, len, whole);
+        memcpy(hash, whole, HASH_SIZE);
+    }
+
+    void digest(unsigned char const *pwd, unsigned int len, unsigned char *digest) const override {
+        if (len <= SHA1Block::MAX_LEN)
+            SHA1Block::hash(pwd, len, digest, SHA1Block::DIGEST_SIZE);
+        else
+            SHA1(pwd, len, digest);
+    }
+};
+
+/**
+ * SHA-256 hashing method
+ */
+class SHA256Hash : public HashMethod {
+
+public:
+    SHA256Hash() : HashMethod("sha256", SHA256Block::DIGEST_SIZE) {}
+
+    ~SHA256Hash() override = default;
+
+    void hash(unsigned char const *pwd, unsigned int len, unsigned char *hash) const override {
+        if (len <= SHA256Block::MAX_LEN) {
+            SHA256Block::hash(pwd, len, hash, HASH_SIZE);
+            return;
+        }
+
+        unsigned char whole[SHA256Block::DIGEST_SIZE];
+        SHA256(pwd, len, whole);
+        memcpy(hash, whole, HASH_SIZE);
+    }
+
+    void digest(unsigned char const *pwd, unsigned int len, unsigned char *digest) const override {
+        if (len <= SHA256Block::MAX_LEN)
+            SHA256Block::hash(pwd, len, digest, SHA256Block::DIGEST_SIZE);
+        else
+            SHA256(pwd, len, digest);
+    }
+};
+
+inline HashMethod *HashMethod::create(std::string const &name) {
+    if (name == "md5")
+        return new MD5Hash();
+    if (name == "ntlm")
+        return new NTLMHash();
+    if (name == "sha1")
+        return new SHA1Hash();
+    if (name == "sha256")
+        return new SHA256Hash();
+
+    return nullptr;
+}
+
+inline std::string HashMethod::names() {
+    return "md5 ntlm sha1 sha256";
+}
+
 #endif //RAINBOWHACKING_HASHMETHOD_HPP
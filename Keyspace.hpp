@@ -0,0 +1,288 @@
+#ifndef RAINBOWHACKING_KEYSPACE_HPP
+#define RAINBOWHACKING_KEYSPACE_HPP
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Password.hpp"
+
+// Charsets of the mask placeholders, and of the default domain: defined here
+// only, for RainbowTable.h and the command line include this header.
+#define LETTERSLOWER "abcdefghijklmnopqrstuvwxyz"
+#define LETTERSUPPER "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
+#define DIGITS "0123456789"
+#define SYMBOLS "!\"#$%&'()*+,-./:;<=>?@[\\]^_`{|}~"
+
+/**
+ * All the passwords of <minLen> to <pwdLen> characters, each character taken
+ * from the charset of its position, numbered from 0 to size() - 1: the
+ * shorter passwords first, then within a length as a mixed radix number
+ * whose first character is the most significant digit.
+ */
+class Keyspace {
+
+private:
+    std::string _domain;                /* The charset of every position if they are the same, else all the characters */
+    std::vector<std::string> _charsets; /* Characters of every position */
+    unsigned int _minLen;
+    unsigned int _pwdLen;
+    uint64_t _size;                     /* Number of passwords, 0 if it does not fit in 64 bits */
+    std::vector<uint64_t> _offsets;     /* Index of the first password of every length from minLen */
+    std::vector<int> _digits;           /* Digit of every character at every position, -1 if not in its charset */
+
+    bool sameCharsets() const {
+        for (std::string const &charset : _charsets) {
+            if (charset != _charsets[0])
+                return false;
+        }
+
+        return !_charsets.empty();
+    }
+
+    void init() {
+        _pwdLen = _charsets.size();
+        _minLen = _minLen > 0 && _minLen < _pwdLen ? _minLen : _pwdLen;
+
+        _domain.clear();
+        _digits.assign((size_t) _pwdLen * 256, -1);
+
+        for (unsigned int i = 0; i < _pwdLen; ++i) {
+            for (unsigned int j = 0; j < _charsets[i].size(); ++j) {
+                auto c = (unsigned char) _charsets[i][j];
+                _digits[i * 256 + c] = j;
+                if (_domain.find((char) c) == std::string::npos)
+                    _domain += (char) c;
+            }
+        }
+
+        // The domain of a table without a mask stays as it is, duplicates included.
+        if (sameCharsets())
+            _domain = _charsets[0];
+
+        // Passwords of every length, then offset of every length.
+        _size = 0;
+        _offsets.clear();
+
+        uint64_t count = 1;
+        bool overflow = false;
+
+        for (unsigned int len = 1; len <= _pwdLen; ++len) {
+            uint64_t radix = _charsets[len - 1].size();
+            overflow = overflow || radix == 0 || count > UINT64_MAX / radix;
+            count = overflow ? 0 : count * radix;
+
+            if (len >= _minLen) {
+                _offsets.push_back(_size);
+                overflow = overflow || _size > UINT64_MAX - count;
+                _size = overflow ? 0 : _size + count;
+            }
+        }
+    }
+
+public:
+    /**
+     * Constructor of the passwords of a single length, from a single domain.
+     * @param domain: All the available characters.
+     * @param pwdLen: The length of the passwords.
+     */
+    Keyspace(std::string const &domain, unsigned int pwdLen)
+            : _charsets(pwdLen, domain), _minLen(pwdLen), _pwdLen(pwdLen) {
+        init();
+        _domain = domain;
+    }
+
+    /**
+     * Constructor
+     * @param charsets: The characters of every position, pwdLen of them.
+     * @param minLen: The length of the shortest passwords, 0 for pwdLen.
+     */
+    Keyspace(std::vector<std::string> charsets, unsigned int minLen)
+            : _charsets(std::move(charsets)), _minLen(minLen), _pwdLen(0) {
+        init();
+    }
+
+    /**
+     * Expands a charset: ?l, ?u, ?d, ?s and ?a stand for the lowercase
+     * letters, uppercase letters, digits, symbols and all of them, ?? for
+     * '?', any other character for itself.
+     * @param spec: The charset, for example "?l?d" or "abc?d".
+     * @param chars: Placeholder for the characters, each of them once.
+     * @return false if the charset is empty or invalid.
+     */
+    static bool parseCharset(std::string const &spec, std::string &chars) {
+        chars.clear();
+
+        for (size_t i = 0; i < spec.size(); ++i) {
+            std::string add(1, spec[i]);
+
+            if (spec[i] == '?') {
+                if (++i == spec.size())
+                    return false;
+
+                switch (spec[i]) {
+                    case 'l': add = LETTERSLOWER; break;
+                    case 'u': add = LETTERSUPPER; break;
+                    case 'd': add = DIGITS; break;
+                    case 's': add = SYMBOLS; break;
+                    case 'a': add = LETTERSLOWER LETTERSUPPER DIGITS SYMBOLS; break;
+                    case '?': add = "?"; break;
+                    default: return false;
+                }
+            }
+
+            for (char c : add) {
+                if (c == ' ' || c == '\0')
+                    return false;
+                if (chars.find(c) == std::string::npos)
+                    chars += c;
+            }
+        }
+
+        return !chars.empty();
+    }
+
+    /**
+     * Expands a mask into the charset of every position: every ?l, ?u, ?d,
+     * ?s or ?a is a position of that charset, every other character a
+     * position of that character only, ?? a position of '?'.
+     * @param mask: The mask, for example "?u?l?l?l?d?d".
+     * @param charsets: Placeholder for the charset of every position.
+     * @return false if the mask is empty, invalid, or longer than MAX_PWD_SIZE.
+     */
+    static bool parseMask(std::string const &mask, std::vector<std::string> &charsets) {
+        charsets.clear();
+
+        for (size_t i = 0; i < mask.size(); ++i) {
+            size_t len = mask[i] == '?' ? 2 : 1;
+            std::string chars;
+
+            if (!parseCharset(mask.substr(i, len), chars) || charsets.size() == MAX_PWD_SIZE)
+                return false;
+
+            charsets.push_back(chars);
+            i += len - 1;
+        }
+
+        return !charsets.empty();
+    }
+
+    /**
+     * Keyspace of a table, whose every position takes the characters of the
+     * domain, or of its position in the mask if there is one.
+     * @param domain: All the available characters, without a mask.
+     * @param mask: The mask, "" for none. Its positions past pwdLen are left out.
+     * @param minLen: The length of the shortest passwords, 0 for pwdLen.
+     * @param pwdLen: The length of the longest passwords.
+     * @param keyspace: Placeholder for the keyspace.
+     * @return false if the mask is invalid or shorter than pwdLen.
+     */
+    static bool create(std::string const &domain, std::string const &mask, unsigned int minLen,
+                       unsigned int pwdLen, Keyspace &keyspace) {
+        std::vector<std::string> charsets(pwdLen, domain);
+
+        if (!mask.empty()) {
+            if (!parseMask(mask, charsets) || charsets.size() < pwdLen)
+                return false;
+            charsets.resize(pwdLen);
+        }
+
+        keyspace = Keyspace(charsets, minLen);
+        return true;
+    }
+
+    /**
+     * @return the charset of every position if they are the same, otherwise
+     * all the characters in order of first appearance.
+     */
+    std::string const &domain() const {
+        return _domain;
+    }
+
+    /**
+     * @return the characters of a position.
+     */
+    std::string const &charset(unsigned int i) const {
+        return _charsets[i];
+    }
+
+    unsigned int minLen() const {
+        return _minLen;
+    }
+
+    unsigned int pwdLen() const {
+        return _pwdLen;
+    }
+
+    /**
+     * @return true if all the passwords have pwdLen characters from the
+     * whole domain, the keyspace of a table without a mask.
+     */
+    bool uniform() const {
+        return _minLen == _pwdLen && sameCharsets();
+    }
+
+    /**
+     * @return the number of passwords, or 0 if it does not fit in 64 bits.
+     */
+    uint64_t size() const {
+        return _size;
+    }
+
+    /**
+     * @return the number of bits needed to store the index of a password.
+     */
+    unsigned int bits() const {
+        unsigned int bits = 0;
+        while (bits < 64 && (_size - 1) >> bits)
+            ++bits;
+        return bits;
+    }
+
+    /**
+     * Computes the index of a password.
+     * @param pwd: The password.
+     * @param index: Placeholder for the index.
+     * @return false if the password is not part of the keyspace.
+     */
+    bool rank(Password const &pwd, uint64_t &index) const {
+        if (pwd.len < _minLen || pwd.len > _pwdLen)
+            return false;
+
+        index = 0;
+        for (unsigned int i = 0; i < pwd.len; ++i) {
+            int digit = _digits[i * 256 + pwd.data[i]];
+            if (digit < 0)
+                return false;
+            index = index * _charsets[i].size() + digit;
+        }
+
+        index += _offsets[pwd.len - _minLen];
+        return true;
+    }
+
+    /**
+     * Computes the password of an index.
+     * @param index: The index, lower than size(). Any index if the passwords
+     * have a single length, taken modulo the number of passwords.
+     * @param pwd: Placeholder for the password.
+     */
+    void unrank(uint64_t index, Password &pwd) const {
+        unsigned int len = _pwdLen;
+
+        if (_minLen < _pwdLen) {
+            len = _minLen;
+            while (len < _pwdLen && index >= _offsets[len + 1 - _minLen])
+                ++len;
+            index -= _offsets[len - _minLen];
+        }
+
+        pwd.len = len;
+        for (unsigned int i = len; i-- > 0;) {
+            pwd.data[i] = _charsets[i][index % _charsets[i].size()];
+            index /= _charsets[i].size();
+        }
+    }
+};
+
+#endif //RAINBOWHACKING_KEYSPACE_HPP
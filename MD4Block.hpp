@@ -0,0 +1,184 @@
+#ifndef RAINBOWHACKING_MD4BLOCK_HPP
+#define RAINBOWHACKING_MD4BLOCK_HPP
+
+#include <cstdint>
+
+/* Initial state */
+const uint32_t MD4_IV[4] = {0x67452301u, 0xefcdab89u, 0x98badcfeu, 0x10325476u};
+
+/* Additive constant of every round */
+const uint32_t MD4_K[3] = {0x00000000u, 0x5a827999u, 0x6ed9eba1u};
+
+/* Rotation of every step */
+const unsigned int MD4_S[48] = {
+        3, 7, 11, 19, 3, 7, 11, 19, 3, 7, 11, 19, 3, 7, 11, 19,
+        3, 5, 9, 13, 3, 5, 9, 13, 3, 5, 9, 13, 3, 5, 9, 13,
+        3, 9, 11, 15, 3, 9, 11, 15, 3, 9, 11, 15, 3, 9, 11, 15
+};
+
+/* Message word read by every step */
+const unsigned int MD4_G[48] = {
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        0, 4, 8, 12, 1, 5, 9, 13, 2, 6, 10, 14, 3, 7, 11, 15,
+        0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15
+};
+
+/**
+ * MD4 of messages which fit in a single block, and NTLM, the MD4 of the
+ * UTF-16LE encoding of a password.
+ *
+ * A password character is a single byte, so its UTF-16LE code unit is the
+ * byte followed by a zero byte: every word of the block holds two
+ * characters, at bits 0 and 16. NTLM hashes of passwords of up to
+ * MAX_NTLM_LEN characters take a single block, and 48 steps against the
+ * 64 of MD5.
+ */
+class MD4Block {
+
+private:
+    static inline uint32_t rotl(uint32_t x, unsigned int s) {
+        return (x << s) | (x >> (32u - s));
+    }
+
+    /**
+     * Round function of step i.
+     */
+    static inline uint32_t round(unsigned int i, uint32_t b, uint32_t c, uint32_t d) {
+        switch (i >> 4u) {
+            case 0: return d ^ (b & (c ^ d));
+            case 1: return (b & c) | (d & (b | c));
+            default: return b ^ c ^ d;
+        }
+    }
+
+    /**
+     * Runs the 48 steps on a block, and adds their result to the state.
+     * @param state: The 4 words of the state, updated.
+     * @param block: The message words.
+     */
+    static inline void update(uint32_t *state, uint32_t const *block) {
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+        #pragma GCC unroll 48
+        for (unsigned int i = 0; i < 48; ++i) {
+            uint32_t f = rotl(a + round(i, b, c, d) + MD4_K[i >> 4u] + block[MD4_G[i]], MD4_S[i]);
+            a = d;
+            d = c;
+            c = b;
+            b = f;
+        }
+
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+    }
+
+    /**
+     * Writes the state as the digest, little-endian.
+     * @param state: The 4 words of the state.
+     * @param digest: Placeholder for the 16 bytes digest.
+     */
+    static inline void write(uint32_t const *state, unsigned char *digest) {
+        for (unsigned int w = 0; w < 4; ++w) {
+            for (unsigned int i = 0; i < 4; ++i)
+                digest[4 * w + i] = (unsigned char) (state[w] >> (8 * i));
+        }
+    }
+
+    /**
+     * Runs the 48 steps on the only block of a message, then writes the digest.
+     * @param block: The message words.
+     * @param digest: Placeholder for the 16 bytes digest.
+     */
+    static inline void compress(uint32_t const *block, unsigned char *digest) {
+        uint32_t state[4] = {MD4_IV[0], MD4_IV[1], MD4_IV[2], MD4_IV[3]};
+
+        update(state, block);
+        write(state, digest);
+    }
+
+public:
+    /* Longest password whose NTLM hash takes a single block */
+    static const unsigned int MAX_NTLM_LEN = 27;
+
+    /**
+     * NTLM hash of a password.
+     * @param pwd: The password.
+     * @param len: The length of the password, at most MAX_NTLM_LEN.
+     * @param digest: Placeholder for the 16 bytes digest.
+     */
+    static inline void ntlm(unsigned char const *pwd, unsigned int len, unsigned char *digest) {
+        uint32_t block[16] = {};
+
+        for (unsigned int i = 0; i < len; ++i)
+            block[i >> 1u] |= (uint32_t) pwd[i] << ((i & 1u) << 4u);
+        block[len >> 1u] |= 0x80u << ((len & 1u) << 4u);
+        block[14] = len << 4u;
+
+        compress(block, digest);
+    }
+
+    /**
+     * NTLM hash of a password of any length, over as many blocks as its
+     * UTF-16LE encoding and padding take.
+     * @param pwd: The password.
+     * @param len: The length of the password.
+     * @param digest: Placeholder for the 16 bytes digest.
+     */
+    static inline void ntlmLong(unsigned char const *pwd, unsigned int len, unsigned char *digest) {
+        uint32_t state[4] = {MD4_IV[0], MD4_IV[1], MD4_IV[2], MD4_IV[3]};
+
+        // Two characters per word, then the padding word, then the length in bits.
+        const uint64_t nWords = ((uint64_t) len + 2) / 2;
+        const uint64_t nBlocks = (nWords + 2 + 15) / 16;
+        const uint64_t bits = (uint64_t) len << 4u;
+
+        for (uint64_t k = 0; k < nBlocks; ++k) {
+            uint32_t block[16] = {};
+
+            for (unsigned int w = 0; w < 16; ++w) {
+                uint64_t i = 2 * (16 * k + w);
+                if (i < len)
+                    block[w] |= pwd[i];
+                if (i + 1 < len)
+                    block[w] |= (uint32_t) pwd[i + 1] << 16u;
+            }
+
+            // The 0x80 byte follows the last code unit, at the word of character len.
+            if (len / 2 / 16 == k)
+                block[(len / 2) % 16] |= 0x80u << ((len & 1u) << 4u);
+
+            if (k == nBlocks - 1) {
+                block[14] = (uint32_t) bits;
+                block[15] = (uint32_t) (bits >> 32u);
+            }
+
+            update(state, block);
+        }
+
+        write(state, digest);
+    }
+
+    /**
+     * NTLM hash of a password whose length is known at compile time, so
+     * that its words are loaded with constant shifts, unrolled.
+     * @tparam Len: The length of the password, at most MAX_NTLM_LEN.
+     */
+    template <unsigned int Len>
+    static inline void ntlmFixed(unsigned char const *pwd, unsigned char *digest) {
+        static_assert(Len <= MAX_NTLM_LEN, "The password must fit in a single block.");
+
+        uint32_t block[16] = {};
+
+        #pragma GCC unroll 28
+        for (unsigned int i = 0; i < Len; ++i)
+            block[i >> 1u] |= (uint32_t) pwd[i] << ((i & 1u) << 4u);
+        block[Len >> 1u] |= 0x80u << ((Len & 1u) << 4u);
+        block[14] = Len << 4u;
+
+        compress(block, digest);
+    }
+};
+
+#endif //RAINBOWHACKING_MD4BLOCK_HPP
@@ -0,0 +1,234 @@
+#ifndef RAINBOWHACKING_MD5BLOCK_HPP
+#define RAINBOWHACKING_MD5BLOCK_HPP
+
+#include <cstdint>
+#include <cstring>
+
+/* Initial state */
+const uint32_t MD5_IV[4] = {0x67452301u, 0xefcdab89u, 0x98badcfeu, 0x10325476u};
+
+/* Additive constant of every step */
+const uint32_t MD5_K[64] = {
+        0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+        0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+        0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+        0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+        0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+        0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+        0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+        0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391
+};
+
+/* Rotation of every step */
+const unsigned int MD5_S[64] = {
+        7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+        5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20, 5, 9, 14, 20,
+        4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+        6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21
+};
+
+/* Message word read by every step */
+const unsigned int MD5_G[64] = {
+        0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+        1, 6, 11, 0, 5, 10, 15, 4, 9, 14, 3, 8, 13, 2, 7, 12,
+        5, 8, 11, 14, 1, 4, 7, 10, 13, 0, 3, 6, 9, 12, 15, 2,
+        0, 7, 14, 5, 12, 3, 10, 1, 8, 15, 6, 13, 4, 11, 2, 9
+};
+
+/**
+ * MD5 of messages of a fixed length, which fit in a single block.
+ * The padding and length words are computed once, at construction.
+ *
+ * It can also compare many messages to a single digest quickly: the last
+ * steps of MD5 only read padding words, so they can be undone on the digest
+ * once. Every message is then only hashed up to the first of these steps,
+ * and most of them are rejected even a few steps before that.
+ */
+class MD5Block {
+
+private:
+    uint32_t _block[16]{};      /* Padding and length words. Message words are left to zero. */
+    unsigned int _len;          /* Length of the messages */
+    unsigned int _nWords;       /* Number of words holding message bytes */
+    unsigned int _firstConst;   /* First step from which only constant words are read */
+
+    static inline uint32_t rotl(uint32_t x, unsigned int s) {
+        return (x << s) | (x >> (32u - s));
+    }
+
+    /**
+     * Round function of step i.
+     */
+    static inline uint32_t round(unsigned int i, uint32_t b, uint32_t c, uint32_t d) {
+        switch (i >> 4u) {
+            case 0: return d ^ (b & (c ^ d));
+            case 1: return c ^ (d & (b ^ c));
+            case 2: return b ^ c ^ d;
+            default: return c ^ (b | ~d);
+        }
+    }
+
+    /**
+     * Runs steps <from> to <to> - 1.
+     * @param x: The registers a, b, c, d. The value computed by a step ends up in b.
+     * @param block: The message words.
+     */
+    static inline void steps(uint32_t *x, uint32_t const *block, unsigned int from, unsigned int to) {
+        uint32_t a = x[0], b = x[1], c = x[2], d = x[3];
+
+        #pragma GCC unroll 64
+        for (unsigned int i = from; i < to; ++i) {
+            uint32_t f = a + round(i, b, c, d) + MD5_K[i] + block[MD5_G[i]];
+            a = d;
+            d = c;
+            c = b;
+            b = b + rotl(f, MD5_S[i]);
+        }
+
+        x[0] = a; x[1] = b; x[2] = c; x[3] = d;
+    }
+
+    /**
+     * Copies a message into the words of a block.
+     */
+    inline void load(unsigned char const *msg, uint32_t *block) const {
+        memcpy(block, _block, sizeof(_block));
+
+        for (unsigned int i = 0; i < _len; ++i)
+            block[i >> 2u] |= (uint32_t) msg[i] << ((i & 3u) << 3u);
+    }
+
+public:
+    /* Longest message that fits in a single block */
+    static const unsigned int MAX_LEN = 55;
+
+    /**
+     * Constructor
+     * @param len: The length of the messages, at most MAX_LEN.
+     */
+    explicit MD5Block(unsigned int len) : _len(len) {
+        _nWords = (len + 3) / 4;
+
+        // Padding byte right after the message, then the length in bits.
+        _block[len >> 2u] = 0x80u << ((len & 3u) << 3u);
+        _block[14] = len << 3u;
+
+        // Walk back from the last step while the steps read a constant word.
+        // The first 4 steps are always run forward.
+        _firstConst = 64;
+        while (_firstConst > 4 && MD5_G[_firstConst - 1] >= _nWords)
+            --_firstConst;
+    }
+
+    /**
+     * Hashes a message.
+     * @param msg: The message, of the length given at construction.
+     * @param digest: Placeholder for the 16 bytes digest.
+     */
+    void hash(unsigned char const *msg, unsigned char *digest) const {
+        uint32_t block[16];
+        uint32_t x[4] = {MD5_IV[0], MD5_IV[1], MD5_IV[2], MD5_IV[3]};
+
+        load(msg, block);
+        steps(x, block, 0, 64);
+
+        // x holds a, b, c, d in this order at the end of the last round.
+        for (unsigned int w = 0; w < 4; ++w) {
+            uint32_t v = x[w] + MD5_IV[w];
+            for (unsigned int i = 0; i < 4; ++i)
+                digest[4 * w + i] = (unsigned char) (v >> (8 * i));
+        }
+    }
+
+    /**
+     * Hashes a message whose length is known at compile time, so that the
+     * message and padding words are loaded with constant shifts, unrolled.
+     * @tparam Len: The length of the message, at most MAX_LEN.
+     * @param msg: The message.
+     * @param digest: Placeholder for the 16 bytes digest.
+     */
+    template <unsigned int Len>
+    static inline void hashFixed(unsigned char const *msg, unsigned char *digest) {
+        static_assert(Len <= MAX_LEN, "The message must fit in a single block.");
+
+        uint32_t block[16] = {};
+
+        #pragma GCC unroll 56
+        for (unsigned int i = 0; i < Len; ++i)
+            block[i >> 2u] |= (uint32_t) msg[i] << ((i & 3u) << 3u);
+        block[Len >> 2u] |= 0x80u << ((Len & 3u) << 3u);
+        block[14] = Len << 3u;
+
+        // Same steps as steps(), in the body so that they are always unrolled.
+        uint32_t a = MD5_IV[0], b = MD5_IV[1], c = MD5_IV[2], d = MD5_IV[3];
+
+        #pragma GCC unroll 64
+        for (unsigned int i = 0; i < 64; ++i) {
+            uint32_t f = a + round(i, b, c, d) + MD5_K[i] + block[MD5_G[i]];
+            a = d;
+            d = c;
+            c = b;
+            b = b + rotl(f, MD5_S[i]);
+        }
+
+        uint32_t const x[4] = {a, b, c, d};
+
+        for (unsigned int w = 0; w < 4; ++w) {
+            uint32_t v = x[w] + MD5_IV[w];
+            for (unsigned int i = 0; i < 4; ++i)
+                digest[4 * w + i] = (unsigned char) (v >> (8 * i));
+        }
+    }
+
+    /**
+     * Undoes the steps which only read constant words on a digest.
+     * @param digest: The digest to compare to.
+     * @param state: Placeholder for the 4 registers before these steps.
+     */
+    void prepare(unsigned char const *digest, uint32_t *state) const {
+        for (unsigned int w = 0; w < 4; ++w) {
+            uint32_t v = 0;
+            for (unsigned int i = 0; i < 4; ++i)
+                v |= (uint32_t) digest[4 * w + i] << (8 * i);
+            state[w] = v - MD5_IV[w];
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+
+        for (unsigned int i = 63; i >= _firstConst; --i) {
+            uint32_t computed = b;
+            b = c;
+            c = d;
+            d = a;
+            a = ((computed - b) >> MD5_S[i] | (computed - b) << (32u - MD5_S[i]))
+                - round(i, b, c, d) - MD5_K[i] - _block[MD5_G[i]];
+        }
+
+        state[0] = a; state[1] = b; state[2] = c; state[3] = d;
+    }
+
+    /**
+     * Checks whether a message hashes to a digest.
+     * @param msg: The message, of the length given at construction.
+     * @param state: The registers computed by prepare() on the digest.
+     * @return true if the message hashes to the digest.
+     */
+    bool matches(unsigned char const *msg, uint32_t const *state) const {
+        uint32_t block[16];
+        uint32_t x[4] = {MD5_IV[0], MD5_IV[1], MD5_IV[2], MD5_IV[3]};
+
+        load(msg, block);
+
+        // The register a before step <_firstConst> is the value computed
+        // 3 steps earlier. Most messages are rejected right there.
+        steps(x, block, 0, _firstConst - 3);
+        if (x[1] != state[0])
+            return false;
+
+        steps(x, block, _firstConst - 3, _firstConst);
+
+        return x[0] == state[0] && x[1] == state[1] && x[2] == state[2] && x[3] == state[3];
+    }
+};
+
+#endif //RAINBOWHACKING_MD5BLOCK_HPP
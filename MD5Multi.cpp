@@ -0,0 +1,135 @@
+#include "MD5Multi.h"
+#include "MD5Block.hpp"
+#include "MD4Block.hpp"
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define MD5MULTI_X86
+#include <emmintrin.h>
+#include "MD5MultiKernel.hpp"
+
+// Defined in MD5MultiAVX2.cpp and MD5MultiAVX512.cpp, which are compiled for their own instruction set.
+unsigned int md5MultiHashAVX2(Password const *pwds, unsigned int n, unsigned char *hashes);
+unsigned int md5MultiHashAVX512(Password const *pwds, unsigned int n, unsigned char *hashes);
+unsigned int ntlmMultiHashAVX2(Password const *pwds, unsigned int n, unsigned char *hashes);
+unsigned int ntlmMultiHashAVX512(Password const *pwds, unsigned int n, unsigned char *hashes);
+
+/**
+ * SSE2 operations, 4 lanes. SSE2 is part of every x86-64 CPU.
+ */
+struct SSE2Ops {
+    typedef __m128i V;
+    static const unsigned int LANES = 4;
+
+    static inline V set1(uint32_t x) { return _mm_set1_epi32((int) x); }
+    static inline V load(uint32_t const *p) { return _mm_load_si128((__m128i const *) p); }
+    static inline void store(uint32_t *p, V x) { _mm_store_si128((__m128i *) p, x); }
+    static inline V add(V x, V y) { return _mm_add_epi32(x, y); }
+
+    template <int S>
+    static inline V rotl(V x) { return _mm_or_si128(_mm_slli_epi32(x, S), _mm_srli_epi32(x, 32 - S)); }
+
+    static inline V F(V b, V c, V d) { return _mm_xor_si128(d, _mm_and_si128(b, _mm_xor_si128(c, d))); }
+    static inline V G(V b, V c, V d) { return _mm_xor_si128(c, _mm_and_si128(d, _mm_xor_si128(b, c))); }
+    static inline V H(V b, V c, V d) { return _mm_xor_si128(_mm_xor_si128(b, c), d); }
+    static inline V I(V b, V c, V d) {
+        return _mm_xor_si128(c, _mm_or_si128(b, _mm_xor_si128(d, _mm_set1_epi32(-1))));
+    }
+    static inline V MAJ(V b, V c, V d) { return _mm_or_si128(_mm_and_si128(b, c), _mm_and_si128(d, _mm_or_si128(b, c))); }
+};
+#endif
+
+MD5Multi::Isa MD5Multi::isa() {
+    static const Isa selected = []() {
+#ifdef MD5MULTI_X86
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx512f"))
+            return AVX512;
+        if (__builtin_cpu_supports("avx2"))
+            return AVX2;
+
+        return SSE2;
+#else
+        return SCALAR;
+#endif
+    }();
+
+    return selected;
+}
+
+char const *MD5Multi::isaName() {
+    switch (isa()) {
+        case AVX512: return "avx512";
+        case AVX2: return "avx2";
+        case SSE2: return "sse2";
+        default: return "scalar";
+    }
+}
+
+unsigned int MD5Multi::lanes() {
+    switch (isa()) {
+        case AVX512: return 16;
+        case AVX2: return 8;
+        case SSE2: return 4;
+        default: return 1;
+    }
+}
+
+void MD5Multi::hash(Password const *pwds, unsigned int n, unsigned char *hashes) {
+
+    // Single block hashing, for every password length.
+    static const std::vector<MD5Block> blocks = []() {
+        std::vector<MD5Block> v;
+        for (unsigned int len = 0; len <= MAX_PWD_SIZE; ++len)
+            v.emplace_back(len);
+        return v;
+    }();
+
+    unsigned int done = 0;
+
+#ifdef MD5MULTI_X86
+    // Hash full groups with the widest engine, then let the narrower ones
+    // take what is left.
+    switch (isa()) {
+        case AVX512:
+            done += md5MultiHashAVX512(pwds, n, hashes);
+            // fall through
+        case AVX2:
+            done += md5MultiHashAVX2(pwds + done, n - done, hashes + done * 16);
+            // fall through
+        case SSE2:
+            done += md5MultiHash<SSE2Ops>(pwds + done, n - done, hashes + done * 16);
+            // fall through
+        default:
+            break;
+    }
+#endif
+
+    // Remaining passwords are hashed one by one.
+    for (; done < n; ++done)
+        blocks[pwds[done].len].hash(pwds[done].data, hashes + done * 16);
+}
+
+void MD5Multi::ntlm(Password const *pwds, unsigned int n, unsigned char *hashes) {
+    unsigned int done = 0;
+
+#ifdef MD5MULTI_X86
+    switch (isa()) {
+        case AVX512:
+            done += ntlmMultiHashAVX512(pwds, n, hashes);
+            // fall through
+        case AVX2:
+            done += ntlmMultiHashAVX2(pwds + done, n - done, hashes + done * 16);
+            // fall through
+        case SSE2:
+            done += ntlmMultiHash<SSE2Ops>(pwds + done, n - done, hashes + done * 16);
+            // fall through
+        default:
+            break;
+    }
+#endif
+
+    for (; done < n; ++done)
+        MD4Block::ntlm(pwds[done].data, pwds[done].len, hashes + done * 16);
+}
@@ -0,0 +1,51 @@
+#ifndef RAINBOWHACKING_MD5MULTI_H
+#define RAINBOWHACKING_MD5MULTI_H
+
+#include "Password.hpp"
+
+/**
+ * Multi-buffer MD5 engine.
+ * Hashes several passwords at once, one password per SIMD lane.
+ * The widest instruction set supported by the CPU is picked at runtime.
+ * It also computes NTLM hashes, whose MD4 compression shares most of the
+ * round functions of MD5.
+ */
+class MD5Multi {
+
+public:
+    /* Instruction sets the engine can run on. */
+    enum Isa { SCALAR, SSE2, AVX2, AVX512 };
+
+    /**
+     * @return the instruction set selected for this CPU.
+     */
+    static Isa isa();
+
+    /**
+     * @return the name of the selected instruction set.
+     */
+    static char const *isaName();
+
+    /**
+     * @return the number of messages hashed in lockstep (1, 4, 8 or 16).
+     */
+    static unsigned int lanes();
+
+    /**
+     * Hashes <n> passwords.
+     * @param pwds: The passwords.
+     * @param n: Number of passwords.
+     * @param hashes: Placeholder for the n digests, stored one after another.
+     */
+    static void hash(Password const *pwds, unsigned int n, unsigned char *hashes);
+
+    /**
+     * Computes the NTLM hashes of <n> passwords.
+     * @param pwds: The passwords, of at most MD4Block::MAX_NTLM_LEN characters.
+     * @param n: Number of passwords.
+     * @param hashes: Placeholder for the n digests, stored one after another.
+     */
+    static void ntlm(Password const *pwds, unsigned int n, unsigned char *hashes);
+};
+
+#endif //RAINBOWHACKING_MD5MULTI_H
@@ -0,0 +1,41 @@
+// This file is compiled with -mavx2. Its code must only run after MD5Multi
+// has checked that the CPU supports AVX2.
+
+#ifdef __AVX2__
+#include <immintrin.h>
+#include "MD5MultiKernel.hpp"
+
+/**
+ * AVX2 operations, 8 lanes.
+ */
+struct AVX2Ops {
+    typedef __m256i V;
+    static const unsigned int LANES = 8;
+
+    static inline V set1(uint32_t x) { return _mm256_set1_epi32((int) x); }
+    static inline V load(uint32_t const *p) { return _mm256_load_si256((__m256i const *) p); }
+    static inline void store(uint32_t *p, V x) { _mm256_store_si256((__m256i *) p, x); }
+    static inline V add(V x, V y) { return _mm256_add_epi32(x, y); }
+
+    template <int S>
+    static inline V rotl(V x) { return _mm256_or_si256(_mm256_slli_epi32(x, S), _mm256_srli_epi32(x, 32 - S)); }
+
+    static inline V F(V b, V c, V d) { return _mm256_xor_si256(d, _mm256_and_si256(b, _mm256_xor_si256(c, d))); }
+    static inline V G(V b, V c, V d) { return _mm256_xor_si256(c, _mm256_and_si256(d, _mm256_xor_si256(b, c))); }
+    static inline V H(V b, V c, V d) { return _mm256_xor_si256(_mm256_xor_si256(b, c), d); }
+    static inline V I(V b, V c, V d) {
+        return _mm256_xor_si256(c, _mm256_or_si256(b, _mm256_xor_si256(d, _mm256_set1_epi32(-1))));
+    }
+    static inline V MAJ(V b, V c, V d) {
+        return _mm256_or_si256(_mm256_and_si256(b, c), _mm256_and_si256(d, _mm256_or_si256(b, c)));
+    }
+};
+
+unsigned int md5MultiHashAVX2(Password const *pwds, unsigned int n, unsigned char *hashes) {
+    return md5MultiHash<AVX2Ops>(pwds, n, hashes);
+}
+
+unsigned int ntlmMultiHashAVX2(Password const *pwds, unsigned int n, unsigned char *hashes) {
+    return ntlmMultiHash<AVX2Ops>(pwds, n, hashes);
+}
+#endif
@@ -0,0 +1,41 @@
+// This file is compiled with -mavx512f. Its code must only run after MD5Multi
+// has checked that the CPU supports AVX-512.
+
+#ifdef __AVX512F__
+#include <immintrin.h>
+#include "MD5MultiKernel.hpp"
+
+/**
+ * AVX-512 operations, 16 lanes.
+ * Rotations and the round functions map to single instructions.
+ */
+struct AVX512Ops {
+    typedef __m512i V;
+    static const unsigned int LANES = 16;
+
+    static inline V set1(uint32_t x) { return _mm512_set1_epi32((int) x); }
+    static inline V load(uint32_t const *p) { return _mm512_load_si512(p); }
+    static inline void store(uint32_t *p, V x) { _mm512_store_si512(p, x); }
+    static inline V add(V x, V y) { return _mm512_add_epi32(x, y); }
+
+    // Same vprold as _mm512_rol_epi32(), whose undefined pass-through
+    // operand makes GCC warn about uninitialized values under -Wall.
+    template <int S>
+    static inline V rotl(V x) { return _mm512_mask_rol_epi32(x, 0xFFFF, x, S); }
+
+    // Truth tables of the round functions, for vpternlogd.
+    static inline V F(V b, V c, V d) { return _mm512_ternarylogic_epi32(b, c, d, 0xCA); }
+    static inline V G(V b, V c, V d) { return _mm512_ternarylogic_epi32(b, c, d, 0xE4); }
+    static inline V H(V b, V c, V d) { return _mm512_ternarylogic_epi32(b, c, d, 0x96); }
+    static inline V I(V b, V c, V d) { return _mm512_ternarylogic_epi32(b, c, d, 0x39); }
+    static inline V MAJ(V b, V c, V d) { return _mm512_ternarylogic_epi32(b, c, d, 0xE8); }
+};
+
+unsigned int md5MultiHashAVX512(Password const *pwds, unsigned int n, unsigned char *hashes) {
+    return md5MultiHash<AVX512Ops>(pwds, n, hashes);
+}
+
+unsigned int ntlmMultiHashAVX512(Password const *pwds, unsigned int n, unsigned char *hashes) {
+    return ntlmMultiHash<AVX512Ops>(pwds, n, hashes);
+}
+#endif
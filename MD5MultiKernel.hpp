@@ -0,0 +1,317 @@
+#ifndef RAINBOWHACKING_MD5MULTIKERNEL_HPP
+#define RAINBOWHACKING_MD5MULTIKERNEL_HPP
+
+#include <cstdint>
+#include <cstring>
+#include "MD5Block.hpp"
+#include "MD4Block.hpp"
+#include "Password.hpp"
+
+/*
+ * Lane-parallel MD5 compression, shared by every instruction set, and the
+ * MD4 compression of NTLM, which reuses the F and H round functions of MD5.
+ * <Ops> wraps the vector type and its operations:
+ *     V, LANES, set1, load, store, add, rotl<S>, F, G, H, I, MAJ.
+ * The kernel is instantiated once per instruction set, in a translation unit
+ * compiled for that instruction set. It lives in an anonymous namespace so
+ * that these instantiations never get merged across translation units.
+ */
+
+namespace {
+
+#define MD5_STEP(FN, a, b, c, d, w, k, s) \
+    a = Ops::add(b, Ops::template rotl<s>(Ops::add(Ops::add(a, Ops::FN(b, c, d)), \
+                                                   Ops::add(Ops::set1(k), Ops::load(block + (w) * W)))))
+
+/**
+ * Compresses one block per lane.
+ * @param block: The message words, word-major (word w of lane l at block[w * LANES + l]).
+ * @param digest: Placeholder for the state words, word-major.
+ */
+template <class Ops>
+inline void md5MultiBlock(uint32_t const *block, uint32_t *digest) {
+    typedef typename Ops::V V;
+    const unsigned int W = Ops::LANES;
+
+    V a = Ops::set1(MD5_IV[0]);
+    V b = Ops::set1(MD5_IV[1]);
+    V c = Ops::set1(MD5_IV[2]);
+    V d = Ops::set1(MD5_IV[3]);
+
+    MD5_STEP(F, a, b, c, d,  0, 0xd76aa478,  7);
+    MD5_STEP(F, d, a, b, c,  1, 0xe8c7b756, 12);
+    MD5_STEP(F, c, d, a, b,  2, 0x242070db, 17);
+    MD5_STEP(F, b, c, d, a,  3, 0xc1bdceee, 22);
+    MD5_STEP(F, a, b, c, d,  4, 0xf57c0faf,  7);
+    MD5_STEP(F, d, a, b, c,  5, 0x4787c62a, 12);
+    MD5_STEP(F, c, d, a, b,  6, 0xa8304613, 17);
+    MD5_STEP(F, b, c, d, a,  7, 0xfd469501, 22);
+    MD5_STEP(F, a, b, c, d,  8, 0x698098d8,  7);
+    MD5_STEP(F, d, a, b, c,  9, 0x8b44f7af, 12);
+    MD5_STEP(F, c, d, a, b, 10, 0xffff5bb1, 17);
+    MD5_STEP(F, b, c, d, a, 11, 0x895cd7be, 22);
+    MD5_STEP(F, a, b, c, d, 12, 0x6b901122,  7);
+    MD5_STEP(F, d, a, b, c, 13, 0xfd987193, 12);
+    MD5_STEP(F, c, d, a, b, 14, 0xa679438e, 17);
+    MD5_STEP(F, b, c, d, a, 15, 0x49b40821, 22);
+
+    MD5_STEP(G, a, b, c, d,  1, 0xf61e2562,  5);
+    MD5_STEP(G, d, a, b, c,  6, 0xc040b340,  9);
+    MD5_STEP(G, c, d, a, b, 11, 0x265e5a51, 14);
+    MD5_STEP(G, b, c, d, a,  0, 0xe9b6c7aa, 20);
+    MD5_STEP(G, a, b, c, d,  5, 0xd62f105d,  5);
+    MD5_STEP(G, d, a, b, c, 10, 0x02441453,  9);
+    MD5_STEP(G, c, d, a, b, 15, 0xd8a1e681, 14);
+    MD5_STEP(G, b, c, d, a,  4, 0xe7d3fbc8, 20);
+    MD5_STEP(G, a, b, c, d,  9, 0x21e1cde6,  5);
+    MD5_STEP(G, d, a, b, c, 14, 0xc33707d6,  9);
+    MD5_STEP(G, c, d, a, b,  3, 0xf4d50d87, 14);
+    MD5_STEP(G, b, c, d, a,  8, 0x455a14ed, 20);
+    MD5_STEP(G, a, b, c, d, 13, 0xa9e3e905,  5);
+    MD5_STEP(G, d, a, b, c,  2, 0xfcefa3f8,  9);
+    MD5_STEP(G, c, d, a, b,  7, 0x676f02d9, 14);
+    MD5_STEP(G, b, c, d, a, 12, 0x8d2a4c8a, 20);
+
+    MD5_STEP(H, a, b, c, d,  5, 0xfffa3942,  4);
+    MD5_STEP(H, d, a, b, c,  8, 0x8771f681, 11);
+    MD5_STEP(H, c, d, a, b, 11, 0x6d9d6122, 16);
+    MD5_STEP(H, b, c, d, a, 14, 0xfde5380c, 23);
+    MD5_STEP(H, a, b, c, d,  1, 0xa4beea44,  4);
+    MD5_STEP(H, d, a, b, c,  4, 0x4bdecfa9, 11);
+    MD5_STEP(H, c, d, a, b,  7, 0xf6bb4b60, 16);
+    MD5_STEP(H, b, c, d, a, 10, 0xbebfbc70, 23);
+    MD5_STEP(H, a, b, c, d, 13, 0x289b7ec6,  4);
+    MD5_STEP(H, d, a, b, c,  0, 0xeaa127fa, 11);
+    MD5_STEP(H, c, d, a, b,  3, 0xd4ef3085, 16);
+    MD5_STEP(H, b, c, d, a,  6, 0x04881d05, 23);
+    MD5_STEP(H, a, b, c, d,  9, 0xd9d4d039,  4);
+    MD5_STEP(H, d, a, b, c, 12, 0xe6db99e5, 11);
+    MD5_STEP(H, c, d, a, b, 15, 0x1fa27cf8, 16);
+    MD5_STEP(H, b, c, d, a,  2, 0xc4ac5665, 23);
+
+    MD5_STEP(I, a, b, c, d,  0, 0xf4292244,  6);
+    MD5_STEP(I, d, a, b, c,  7, 0x432aff97, 10);
+    MD5_STEP(I, c, d, a, b, 14, 0xab9423a7, 15);
+    MD5_STEP(I, b, c, d, a,  5, 0xfc93a039, 21);
+    MD5_STEP(I, a, b, c, d, 12, 0x655b59c3,  6);
+    MD5_STEP(I, d, a, b, c,  3, 0x8f0ccc92, 10);
+    MD5_STEP(I, c, d, a, b, 10, 0xffeff47d, 15);
+    MD5_STEP(I, b, c, d, a,  1, 0x85845dd1, 21);
+    MD5_STEP(I, a, b, c, d,  8, 0x6fa87e4f,  6);
+    MD5_STEP(I, d, a, b, c, 15, 0xfe2ce6e0, 10);
+    MD5_STEP(I, c, d, a, b,  6, 0xa3014314, 15);
+    MD5_STEP(I, b, c, d, a, 13, 0x4e0811a1, 21);
+    MD5_STEP(I, a, b, c, d,  4, 0xf7537e82,  6);
+    MD5_STEP(I, d, a, b, c, 11, 0xbd3af235, 10);
+    MD5_STEP(I, c, d, a, b,  2, 0x2ad7d2bb, 15);
+    MD5_STEP(I, b, c, d, a,  9, 0xeb86d391, 21);
+
+    Ops::store(digest, Ops::add(a, Ops::set1(MD5_IV[0])));
+    Ops::store(digest + W, Ops::add(b, Ops::set1(MD5_IV[1])));
+    Ops::store(digest + 2 * W, Ops::add(c, Ops::set1(MD5_IV[2])));
+    Ops::store(digest + 3 * W, Ops::add(d, Ops::set1(MD5_IV[3])));
+}
+
+#undef MD5_STEP
+
+/**
+ * Hashes as many full groups of LANES passwords as possible.
+ * @param pwds: The passwords.
+ * @param n: Number of passwords.
+ * @param hashes: Placeholder for the digests.
+ * @return The number of passwords hashed (a multiple of LANES).
+ */
+template <class Ops>
+unsigned int md5MultiHash(Password const *pwds, unsigned int n, unsigned char *hashes) {
+    const unsigned int W = Ops::LANES;
+
+    alignas(64) uint32_t block[16 * W] = {};
+    alignas(64) uint32_t digest[4 * W];
+
+    // Words written by the previous groups. The words after them are still zero.
+    unsigned int dirty = 0;
+
+    unsigned int i = 0;
+
+    for (; i + W <= n; i += W) {
+        // Words holding the passwords and their 0x80 padding byte.
+        unsigned int nWords = dirty;
+        for (unsigned int l = 0; l < W; ++l)
+            if (pwds[i + l].len / 4u + 1 > nWords)
+                nWords = pwds[i + l].len / 4u + 1;
+        dirty = nWords;
+
+        // Transpose the passwords into the block, one lane each.
+        for (unsigned int l = 0; l < W; ++l) {
+            Password const &pwd = pwds[i + l];
+
+            for (unsigned int w = 0; w < nWords; ++w) {
+                // Bytes of the password in this word. Whole words are read
+                // from the buffer, which is large enough for all of them.
+                int rem = (int) pwd.len - 4 * (int) w;
+                uint32_t word;
+
+                if (rem >= 4) {
+                    memcpy(&word, pwd.data + 4 * w, 4);
+                } else if (rem > 0) {
+                    memcpy(&word, pwd.data + 4 * w, 4);
+                    word = (word & ((1u << (8u * rem)) - 1)) | (0x80u << (8u * rem));
+                } else {
+                    word = rem == 0 ? 0x80u : 0;
+                }
+
+                block[w * W + l] = word;
+            }
+
+            block[14 * W + l] = (uint32_t) pwd.len << 3u;
+        }
+
+        md5MultiBlock<Ops>(block, digest);
+
+        for (unsigned int l = 0; l < W; ++l)
+            for (unsigned int w = 0; w < 4; ++w)
+                memcpy(hashes + (i + l) * 16 + 4 * w, &digest[w * W + l], 4);
+    }
+
+    return i;
+}
+
+#define MD4_STEP(FN, a, b, c, d, w, k, s) \
+    a = Ops::template rotl<s>(Ops::add(Ops::add(a, Ops::FN(b, c, d)), \
+                                       Ops::add(Ops::set1(k), Ops::load(block + (w) * W))))
+
+/**
+ * Compresses one MD4 block per lane.
+ * @param block: The message words, word-major (word w of lane l at block[w * LANES + l]).
+ * @param digest: Placeholder for the state words, word-major.
+ */
+template <class Ops>
+inline void md4MultiBlock(uint32_t const *block, uint32_t *digest) {
+    typedef typename Ops::V V;
+    const unsigned int W = Ops::LANES;
+
+    V a = Ops::set1(MD4_IV[0]);
+    V b = Ops::set1(MD4_IV[1]);
+    V c = Ops::set1(MD4_IV[2]);
+    V d = Ops::set1(MD4_IV[3]);
+
+    MD4_STEP(F, a, b, c, d,  0, 0,  3);
+    MD4_STEP(F, d, a, b, c,  1, 0,  7);
+    MD4_STEP(F, c, d, a, b,  2, 0, 11);
+    MD4_STEP(F, b, c, d, a,  3, 0, 19);
+    MD4_STEP(F, a, b, c, d,  4, 0,  3);
+    MD4_STEP(F, d, a, b, c,  5, 0,  7);
+    MD4_STEP(F, c, d, a, b,  6, 0, 11);
+    MD4_STEP(F, b, c, d, a,  7, 0, 19);
+    MD4_STEP(F, a, b, c, d,  8, 0,  3);
+    MD4_STEP(F, d, a, b, c,  9, 0,  7);
+    MD4_STEP(F, c, d, a, b, 10, 0, 11);
+    MD4_STEP(F, b, c, d, a, 11, 0, 19);
+    MD4_STEP(F, a, b, c, d, 12, 0,  3);
+    MD4_STEP(F, d, a, b, c, 13, 0,  7);
+    MD4_STEP(F, c, d, a, b, 14, 0, 11);
+    MD4_STEP(F, b, c, d, a, 15, 0, 19);
+
+    MD4_STEP(MAJ, a, b, c, d,  0, 0x5a827999,  3);
+    MD4_STEP(MAJ, d, a, b, c,  4, 0x5a827999,  5);
+    MD4_STEP(MAJ, c, d, a, b,  8, 0x5a827999,  9);
+    MD4_STEP(MAJ, b, c, d, a, 12, 0x5a827999, 13);
+    MD4_STEP(MAJ, a, b, c, d,  1, 0x5a827999,  3);
+    MD4_STEP(MAJ, d, a, b, c,  5, 0x5a827999,  5);
+    MD4_STEP(MAJ, c, d, a, b,  9, 0x5a827999,  9);
+    MD4_STEP(MAJ, b, c, d, a, 13, 0x5a827999, 13);
+    MD4_STEP(MAJ, a, b, c, d,  2, 0x5a827999,  3);
+    MD4_STEP(MAJ, d, a, b, c,  6, 0x5a827999,  5);
+    MD4_STEP(MAJ, c, d, a, b, 10, 0x5a827999,  9);
+    MD4_STEP(MAJ, b, c, d, a, 14, 0x5a827999, 13);
+    MD4_STEP(MAJ, a, b, c, d,  3, 0x5a827999,  3);
+    MD4_STEP(MAJ, d, a, b, c,  7, 0x5a827999,  5);
+    MD4_STEP(MAJ, c, d, a, b, 11, 0x5a827999,  9);
+    MD4_STEP(MAJ, b, c, d, a, 15, 0x5a827999, 13);
+
+    MD4_STEP(H, a, b, c, d,  0, 0x6ed9eba1,  3);
+    MD4_STEP(H, d, a, b, c,  8, 0x6ed9eba1,  9);
+    MD4_STEP(H, c, d, a, b,  4, 0x6ed9eba1, 11);
+    MD4_STEP(H, b, c, d, a, 12, 0x6ed9eba1, 15);
+    MD4_STEP(H, a, b, c, d,  2, 0x6ed9eba1,  3);
+    MD4_STEP(H, d, a, b, c, 10, 0x6ed9eba1,  9);
+    MD4_STEP(H, c, d, a, b,  6, 0x6ed9eba1, 11);
+    MD4_STEP(H, b, c, d, a, 14, 0x6ed9eba1, 15);
+    MD4_STEP(H, a, b, c, d,  1, 0x6ed9eba1,  3);
+    MD4_STEP(H, d, a, b, c,  9, 0x6ed9eba1,  9);
+    MD4_STEP(H, c, d, a, b,  5, 0x6ed9eba1, 11);
+    MD4_STEP(H, b, c, d, a, 13, 0x6ed9eba1, 15);
+    MD4_STEP(H, a, b, c, d,  3, 0x6ed9eba1,  3);
+    MD4_STEP(H, d, a, b, c, 11, 0x6ed9eba1,  9);
+    MD4_STEP(H, c, d, a, b,  7, 0x6ed9eba1, 11);
+    MD4_STEP(H, b, c, d, a, 15, 0x6ed9eba1, 15);
+
+    Ops::store(digest, Ops::add(a, Ops::set1(MD4_IV[0])));
+    Ops::store(digest + W, Ops::add(b, Ops::set1(MD4_IV[1])));
+    Ops::store(digest + 2 * W, Ops::add(c, Ops::set1(MD4_IV[2])));
+    Ops::store(digest + 3 * W, Ops::add(d, Ops::set1(MD4_IV[3])));
+}
+
+#undef MD4_STEP
+
+/**
+ * NTLM hashes as many full groups of LANES passwords as possible.
+ * @param pwds: The passwords, of at most MD4Block::MAX_NTLM_LEN characters.
+ * @param n: Number of passwords.
+ * @param hashes: Placeholder for the digests.
+ * @return The number of passwords hashed (a multiple of LANES).
+ */
+template <class Ops>
+unsigned int ntlmMultiHash(Password const *pwds, unsigned int n, unsigned char *hashes) {
+    const unsigned int W = Ops::LANES;
+
+    alignas(64) uint32_t block[16 * W] = {};
+    alignas(64) uint32_t digest[4 * W];
+
+    // Words written by the previous groups. The words after them are still zero.
+    unsigned int dirty = 0;
+
+    unsigned int i = 0;
+
+    for (; i + W <= n; i += W) {
+        // Words holding the UTF-16LE passwords and their 0x80 padding byte.
+        unsigned int nWords = dirty;
+        for (unsigned int l = 0; l < W; ++l)
+            if (pwds[i + l].len / 2u + 1 > nWords)
+                nWords = pwds[i + l].len / 2u + 1;
+        dirty = nWords;
+
+        // Transpose the passwords into the block, two characters per word.
+        for (unsigned int l = 0; l < W; ++l) {
+            Password const &pwd = pwds[i + l];
+
+            for (unsigned int w = 0; w < nWords; ++w) {
+                int rem = (int) pwd.len - 2 * (int) w;
+                uint32_t word;
+
+                if (rem >= 2)
+                    word = pwd.data[2 * w] | (uint32_t) pwd.data[2 * w + 1] << 16u;
+                else if (rem == 1)
+                    word = pwd.data[2 * w] | 0x800000u;
+                else
+                    word = rem == 0 ? 0x80u : 0;
+
+                block[w * W + l] = word;
+            }
+
+            block[14 * W + l] = (uint32_t) pwd.len << 4u;
+        }
+
+        md4MultiBlock<Ops>(block, digest);
+
+        for (unsigned int l = 0; l < W; ++l)
+            for (unsigned int w = 0; w < 4; ++w)
+                memcpy(hashes + (i + l) * 16 + 4 * w, &digest[w * W + l], 4);
+    }
+
+    return i;
+}
+
+}
+
+#endif //RAINBOWHACKING_MD5MULTIKERNEL_HPP
@@ -0,0 +1,32 @@
+#include "MappedFile.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(std::string const &filePath) {
+    _data = nullptr;
+    _size = 0;
+
+    int fd = open(filePath.c_str(), O_RDONLY);
+    if (fd < 0)
+        return;
+
+    struct stat st{};
+    if (fstat(fd, &st) == 0 && st.st_size > 0) {
+        // A shared mapping, so that all the processes using the table share its pages.
+        void *data = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (data != MAP_FAILED) {
+            _data = data;
+            _size = st.st_size;
+        }
+    }
+
+    // The mapping stays valid once the file is closed.
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (_data)
+        munmap(_data, _size);
+}
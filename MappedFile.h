@@ -0,0 +1,43 @@
+#ifndef RAINBOWHACKING_MAPPEDFILE_H
+#define RAINBOWHACKING_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+
+/**
+ * Read-only memory mapping of a whole file.
+ * Pages are loaded on first access, and shared through the page cache with
+ * every other process mapping the same file.
+ */
+class MappedFile {
+
+private:
+    void *_data;
+    size_t _size;
+
+public:
+    /**
+     * Maps a file. isOpen() tells whether it succeeded.
+     * @param filePath: The path of the file to map.
+     */
+    explicit MappedFile(std::string const &filePath);
+
+    ~MappedFile();
+
+    MappedFile(MappedFile const &) = delete;
+    MappedFile &operator=(MappedFile const &) = delete;
+
+    bool isOpen() const {
+        return _data != nullptr;
+    }
+
+    unsigned char const *data() const {
+        return static_cast<unsigned char const *>(_data);
+    }
+
+    size_t size() const {
+        return _size;
+    }
+};
+
+#endif //RAINBOWHACKING_MAPPEDFILE_H
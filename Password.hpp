@@ -0,0 +1,61 @@
+#ifndef RAINBOWHACKING_PASSWORD_HPP
+#define RAINBOWHACKING_PASSWORD_HPP
+
+#include <cstring>
+#include <string>
+
+#define MAX_PWD_SIZE 55 /* Longest password supported, so that it fits in a single hash block */
+
+/**
+ * Fixed-capacity password buffer.
+ * Passwords flow through hashing and reduction without any heap allocation.
+ * The whole buffer is 56 bytes, so that it can be read as 14 words whatever
+ * the length of the password.
+ */
+struct Password {
+    unsigned char data[MAX_PWD_SIZE];   /* The characters, not null terminated */
+    unsigned char len;                  /* Number of characters */
+
+    /**
+     * Copies a string into the buffer.
+     * @param str: The string, of at most MAX_PWD_SIZE characters.
+     */
+    void set(std::string const &str) {
+        len = (unsigned char) str.size();
+        memcpy(data, str.c_str(), len);
+    }
+
+    /**
+     * Copies a password stored on <size> bytes, padded with null bytes when
+     * it is shorter, as the start passwords of a table of several lengths.
+     * @param stored: The <size> bytes.
+     */
+    void load(unsigned char const *stored, unsigned int size) {
+        memcpy(data, stored, size);
+        len = (unsigned char) size;
+        while (len > 0 && data[len - 1] == 0)
+            --len;
+    }
+
+    /**
+     * Stores the password on <size> bytes, padded with null bytes.
+     * @param stored: Placeholder for the <size> bytes, size being at least len.
+     */
+    void store(unsigned char *stored, unsigned int size) const {
+        memcpy(stored, data, len);
+        memset(stored + len, 0, size - len);
+    }
+
+    /**
+     * @return the password as a string.
+     */
+    std::string str() const {
+        return std::string(reinterpret_cast<char const *>(data), len);
+    }
+
+    bool operator==(Password const &other) const {
+        return len == other.len && memcmp(data, other.data, len) == 0;
+    }
+};
+
+#endif //RAINBOWHACKING_PASSWORD_HPP
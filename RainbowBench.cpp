@@ -0,0 +1,155 @@
+#include "Benchmark.h"
+#include <algorithm>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <cstdlib>
+#include <omp.h>
+
+using namespace std;
+
+/**
+ * Micro-benchmarks of the hot paths, printed as a single JSON object on the
+ * standard output, so that runs can be compared to catch regressions.
+ * Usage: rainbow_bench [scale], scale multiplying the work of every
+ * benchmark, 1 by default, 0.1 for a quick run.
+ */
+
+#define BENCH_DOMAIN LETTERSLOWER LETTERSUPPER DIGITS
+#define BENCH_PWD_LEN 7
+#define BENCH_CHAIN_LEN 1000
+#define BENCH_FILE "rainbow_bench.tmp"
+
+/**
+ * Creates a table of the benchmark domain and password length, with the
+ * progress messages of its generation left out of the output.
+ */
+static RainbowTable *createTable(string const &hashName, unsigned int chainLen, unsigned int nChains,
+                                 unsigned int reduction = REDUCE_BYTES) {
+    TableOptions options;
+    options.reduction = reduction;
+
+    streambuf *out = cout.rdbuf(nullptr);
+    auto *table = new RainbowTable(chainLen, nChains, BENCH_DOMAIN, BENCH_PWD_LEN, HashMethod::create(hashName),
+                                   options);
+    cout.rdbuf(out);
+    cout.clear();
+
+    return table;
+}
+
+int main(int argc, char **argv) {
+    const double scale = argc > 1 ? atof(argv[1]) : 1.0;
+
+    if (scale <= 0.0) {
+        cerr << "Usage: " << argv[0] << " [scale]" << endl;
+        return EXIT_FAILURE;
+    }
+
+    auto scaled = [scale](double n) { return (unsigned long) max(1.0, n * scale); };
+
+    ostringstream json;
+    json.precision(6);
+    json << "{\n  \"threads\": " << omp_get_max_threads() << ",\n  \"scale\": " << scale << ",\n";
+
+    // Hashing methods: raw hashes, then chain steps and whole chains.
+    json << "  \"hash\": {";
+
+    istringstream names(HashMethod::names());
+    string name;
+
+    for (bool first = true; names >> name; first = false) {
+        HashMethod *hashMethod = HashMethod::create(name);
+        RainbowTable *table = createTable(name, BENCH_CHAIN_LEN, 0);
+
+        double hashes = Benchmark::hashRate(*hashMethod, BENCH_PWD_LEN, scaled(4e6));
+        double steps = Benchmark::chainSteps(*table, scaled(2e6));
+        double batchSteps = Benchmark::chainStepsBatch(*table, scaled(4e6));
+
+        json << (first ? "\n" : ",\n") << "    \"" << name << "\": {\"hashes_per_second\": " << hashes
+             << ", \"chain_steps_per_second\": " << batchSteps
+             << ", \"chains_per_second\": " << steps / BENCH_CHAIN_LEN
+             << ", \"batch_chains_per_second\": " << batchSteps / BENCH_CHAIN_LEN << "}";
+
+        delete hashMethod;
+        delete table;
+    }
+
+    json << "\n  },\n";
+
+    // Reduction functions, on their own.
+    json << "  \"reduce\": {";
+
+    for (unsigned int reduction = 0; reduction < REDUCE_COUNT; ++reduction) {
+        RainbowTable *table = createTable("md5", BENCH_CHAIN_LEN, 0, reduction);
+
+        json << (reduction == 0 ? "\n" : ",\n") << "    \"" << Reduction::name(reduction)
+             << "\": {\"reductions_per_second\": " << Benchmark::reduceRate(*table, scaled(2e7)) << "}";
+
+        delete table;
+    }
+
+    json << "\n  },\n";
+
+    // End hash lookups missing tables of growing sizes.
+    json << "  \"lookup\": [";
+
+    const unsigned int lookupSizes[] = {10000, 100000, 1000000, 4000000};
+
+    for (unsigned int i = 0; i < 4; ++i) {
+        auto nChains = (unsigned int) scaled(lookupSizes[i]);
+        RainbowTable *table = createTable("md5", 1, nChains);
+        auto nLookups = (unsigned int) scaled(1e6);
+
+        json << (i == 0 ? "\n" : ",\n") << "    {\"chains\": " << nChains
+             << ", \"probes_per_second\": " << Benchmark::missLookups(*table, nLookups)
+             << ", \"batch_probes_per_second\": " << Benchmark::missLookupsBatch(*table, nLookups) << "}";
+
+        delete table;
+    }
+
+    json << "\n  ],\n";
+
+    // Sorting of the chains when a table is built.
+    json << "  \"build\": [";
+
+    const unsigned int buildSizes[] = {100000, 1000000, 4000000};
+
+    for (unsigned int i = 0; i < 3; ++i) {
+        auto nChains = (unsigned int) scaled(buildSizes[i]);
+        double time = Benchmark::buildTime(nChains, BENCH_PWD_LEN);
+
+        json << (i == 0 ? "\n" : ",\n") << "    {\"chains\": " << nChains << ", \"seconds\": " << time
+             << ", \"chains_per_second\": " << nChains / time << "}";
+    }
+
+    json << "\n  ],\n";
+
+    // Table files of both formats.
+    json << "  \"file\": {";
+
+    RainbowTable *table = createTable("md5", 1, (unsigned int) scaled(1e6));
+    const string formats[] = {"rbt", "txt"};
+    bool failed = false;
+
+    for (unsigned int i = 0; i < 2; ++i) {
+        double bytes = 0.0, writeRate = 0.0, readRate = 0.0;
+        string filePath = string(BENCH_FILE) + (i == 0 ? TABLE_FILE_EXTENSION : ".txt");
+
+        if (!Benchmark::fileRates(*table, filePath, bytes, writeRate, readRate)) {
+            cerr << "Could not write or read back " << filePath << endl;
+            failed = true;
+        }
+
+        json << (i == 0 ? "\n" : ",\n") << "    \"" << formats[i] << "\": {\"bytes\": " << bytes
+             << ", \"write_mb_per_second\": " << writeRate / 1e6
+             << ", \"read_mb_per_second\": " << readRate / 1e6 << "}";
+    }
+
+    delete table;
+
+    json << "\n  }\n}\n";
+    cout << json.str();
+
+    return failed ? EXIT_FAILURE : EXIT_SUCCESS;
+}
@@ -3,24 +3,50 @@
 //
 
 #include "RainbowHacking.h"
+#include "Benchmark.h"
+#include "TableFile.h"
+#include "TextTableFile.h"
 #include <iostream>
 #include <iomanip>
 #include <csignal>
 #include <cstdlib>
 #include <vector>
+#include <algorithm>
+#include <omp.h>
 
 using namespace std;
 
-RainbowTable** RainbowHacking::_rainInstance = nullptr;
+RainbowHacking* RainbowHacking::_instance = nullptr;
 
 RainbowHacking::RainbowHacking() {
     this->_rain = nullptr;
-    RainbowHacking::_rainInstance = &this->_rain;
+    this->_hashName = "md5";
+    this->_charset = string(LETTERSLOWER) + LETTERSUPPER + DIGITS;
+    RainbowHacking::_instance = this;
     signal(SIGINT, RainbowHacking::handleSignalCTRLC);
 }
 
 RainbowHacking::~RainbowHacking() {
+    clearTables();
+}
+
+TableSet RainbowHacking::tables() const {
+    TableSet set;
+
+    set.add(_rain);
+    for (RainbowTable const *table : _others)
+        set.add(table);
+
+    return set;
+}
+
+void RainbowHacking::clearTables() {
     delete _rain;
+    _rain = nullptr;
+
+    for (RainbowTable *table : _others)
+        delete table;
+    _others.clear();
 }
 
 void RainbowHacking::printInstructions() {
@@ -29,12 +55,59 @@ void RainbowHacking::printInstructions() {
          << "\tCreates a new rainbow table with [nChains] chains of length [chainLen]" << endl
          << "\tpasswords of length [pwdLen] with domain [domain], and using hash function [hashMethod]" << endl
          << "\t('md5' for md5 hash)." << endl;
+    cout << "set [option] [value] -- Sets a build option of the next tables:" << endl
+         << "\tcheckpoints [c1,c2,...|none] -- Columns at which a bit of every chain is kept, to reject" << endl
+         << "\t\tfalse alarms without regenerating the chains." << endl
+         << "\tperfect [0|1] -- Keeps a single chain per end hash, generating chains until [nChains]" << endl
+         << "\t\tdistinct end hashes are reached." << endl
+         << "\tdp [bits] -- Ends every chain at the first hash whose top [bits] bits are zero, [chainLen]" << endl
+         << "\t\tbeing the longest chain kept. 0 for a rainbow table." << endl
+         << "\ttable [index] -- Index of the table in a set of tables, mixed into the reduction, so that" << endl
+         << "\t\tthe tables of a set find different passwords." << endl
+         << "\tfilter [bits] -- Bits per chain of a filter rejecting most hashes which are not end" << endl
+         << "\t\thashes with a single cache line read, about 10 for 1% false positives. 0 for none." << endl
+         << "\tdirectory [0|1] -- Looks end hashes up through a directory of their top bits, in about" << endl
+         << "\t\ttwo cache misses whatever the size of the table, for about a byte per chain." << endl
+         << "\tseed [n] -- Index in the keyspace of the start password of the first chain. Chain i starts" << endl
+         << "\t\tat the password of index [n] + i, so that no two chains start at the same password." << endl
+         << "\tfirst [i] -- Index of the first chain, to generate a table by ranges of chains." << endl
+         << "\thash [name] -- Hashing method: " << HashMethod::names() << ". Digests longer than 16" << endl
+         << "\t\tbytes are read and shown in full, the chains keeping their first 16 bytes." << endl
+         << "\treduction [bytes|index|keyspace] -- Reduction function. 'bytes' picks every character from a" << endl
+         << "\t\tbyte of the hash, 'index' reads the whole hash as the digits of the password, unbiased, for" << endl
+         << "\t\tfewer merges, 'keyspace' as the index of the password in the keyspace." << endl
+         << "\tcharset [chars] -- Characters of the passwords, '?l?u?d' by default. ?l, ?u, ?d, ?s and ?a" << endl
+         << "\t\tstand for the lowercase letters, uppercase letters, digits, symbols and all of them." << endl
+         << "\tmask [mask|none] -- Charset of every position, as '?u?l?l?l?d?d', ?? for '?' and any other" << endl
+         << "\t\tcharacter for itself. Passwords of [pwdLen] characters take its first [pwdLen] positions." << endl
+         << "\tminLen [n] -- Length of the shortest passwords, from [n] to [pwdLen] characters. 0 for [pwdLen]." << endl
+         << "\t\tA mask or a length range reduces through the keyspace index of the passwords." << endl
+         << "\tmemory [MB] -- Memory a table built with 'build' stays within." << endl;
+    cout << "build [chainLen] [nChains] [pwdLen] [path] -- Builds a table straight into the " TABLE_FILE_EXTENSION << endl
+         << "\tfile [path], sorting it on disk, so that it can be larger than the memory, then loads it." << endl
+         << "\tA perfect table gets more runs until [nChains] distinct end hashes are kept." << endl;
     cout << "crackH [hash] -- Tries to find the password with [hash]." << endl;
     cout << "crackW [password] -- Tries to find the password with the hash of [password]." << endl;
-    cout << "save [filePath] -- Saves a rainbow table to [filePath]." << endl;
+    cout << "crackF [hashFile] [resultFile] -- Cracks all the hashes of [hashFile] at once, and writes" << endl
+         << "\tthe ones found to [resultFile] as 'hash password' lines." << endl;
+    cout << "save [filePath] -- Saves a rainbow table to [filePath], as a binary table file if it ends with '"
+         << TABLE_FILE_EXTENSION << "'." << endl;
     cout << "load [filePath] -- Load a rainbow table from [filePath]." << endl;
+    cout << "addTable [filePath] -- Loads another table from [filePath], looked up along with the current one." << endl;
+    cout << "convert [source] [destination] -- Converts a table file, to a binary table file if [destination] ends with '"
+         << TABLE_FILE_EXTENSION << "', to a text file otherwise." << endl;
+    cout << "verify [filePath] -- Checks the checksums of the binary table file [filePath]." << endl;
     cout << "genPwd [n] [filePath] -- Generates [n] random valid passwords and writes them to [filePath]." << endl;
     cout << "testPwd [filePath] -- Reads a list of passwords from [filePath], and tries to crack them." << endl;
+    cout << "compact [bits] -- Stores the current table as a compact index, keeping [bits] bits of every end hash." << endl;
+    cout << "bench -- Measures the chain steps per second of the current table, its end hash lookups" << endl
+         << "\tper second, and its crack latency from one thread to all of them." << endl;
+    cout << "coverage [chainLen] [nChains] [pwdLen] -- Builds a table with every reduction function, and" << endl
+         << "\tcompares their part of distinct end hashes and their success rates on random passwords" << endl
+         << "\twith the ones the planner expects." << endl;
+    cout << "plan [nTables] [memory MB] [success %] [pwdLen] -- Recommends the length and number of chains" << endl
+         << "\tof [nTables] tables within [memory MB] cracking [success %] of the passwords of the current" << endl
+         << "\tcharset, mask and lengths, with their coverage, merges, precomputation and lookup costs." << endl;
     cout << "quit -- Quits the program." << endl;
 }
 
@@ -48,13 +121,21 @@ double RainbowHacking::computeTime(struct timeval const &t0) {
 
 double RainbowHacking::crackHash(string const &hashStr, bool &hasFound) const {
 
-    unsigned char hash[HASH_SIZE];
-    MD5Hash::hexConvert(hashStr.c_str(), hash);
+    const unsigned int size = _rain->digestSize();
+    unsigned char hash[MAX_DIGEST_SIZE];
+
+    if (hashStr.size() != 2 * size) {
+        cerr << "Expected a hash of " << 2 * size << " hexadecimal digits." << endl;
+        hasFound = false;
+        return 0.0;
+    }
+
+    HashMethod::hexConvert(hashStr.c_str(), hash, size);
 
     struct timeval t{};
     gettimeofday(&t, nullptr);
 
-    string res = _rain->crackHash(hash);
+    string res = tables().crackHash(hash);
 
     double time = computeTime(t);
 
@@ -77,14 +158,14 @@ double RainbowHacking::crackWord(std::string const &pwd, bool &hasFound) const {
     struct timeval t{};
     gettimeofday(&t, nullptr);
 
-    string res = _rain->crackPassword(pwd);
+    string res = tables().crackPassword(pwd);
 
     double time = computeTime(t);
 
-    unsigned char hash[HASH_SIZE];
-    _rain->hashPassword(pwd, hash);
+    unsigned char digest[MAX_DIGEST_SIZE];
+    _rain->digestPassword(pwd, digest);
 
-    cout << "'" << pwd << "' --> '" << MD5Hash::convertHexString(hash) << "' --> ";
+    cout << "'" << pwd << "' --> '" << HashMethod::convertHexString(digest, _rain->digestSize()) << "' --> ";
 
     hasFound = !res.empty();
 
@@ -99,32 +180,121 @@ double RainbowHacking::crackWord(std::string const &pwd, bool &hasFound) const {
     return time;
 }
 
+double RainbowHacking::crackHashFile(std::string const &hashPath, std::string const &resultPath) const {
+
+    ifstream in(hashPath.c_str());
+
+    if (!in) {
+        cerr << "Could not read from file <" << hashPath << ">." << endl;
+        return 0.0;
+    }
+
+    // Read the hashes, one per line. Only their first HASH_SIZE bytes are looked up.
+    vector<unsigned char> hashes;
+    vector<string> hashStrs;
+    unsigned char hash[HASH_SIZE];
+    string hashStr;
+    int invalid = 0;
+
+    while (in >> hashStr) {
+        if (hashStr.size() == 2 * _rain->digestSize() && TextTableFile::decodeHex(hashStr.c_str(), hash)) {
+            hashes.insert(hashes.end(), hash, hash + HASH_SIZE);
+            hashStrs.push_back(hashStr);
+        } else {
+            ++invalid;
+        }
+    }
+
+    in.close();
+
+    if (invalid > 0)
+        cerr << "Skipped " << invalid << " malformed hashes." << endl;
+
+    ofstream out(resultPath.c_str());
+
+    if (!out) {
+        cerr << "Could not write to file <" << resultPath << ">." << endl;
+        return 0.0;
+    }
+
+    const unsigned int n = hashes.size() / HASH_SIZE;
+
+    cout << "Total " << n << " hashes." << endl;
+
+    struct timeval t{};
+    gettimeofday(&t, nullptr);
+
+    vector<string> results;
+    tables().crackHashes(hashes.data(), n, results);
+
+    double time = computeTime(t);
+
+    // Write the hashes found.
+    unsigned int success = 0;
+
+    for (unsigned int i = 0; i < n; ++i) {
+        if (results[i].empty())
+            continue;
+
+        out << hashStrs[i] << " " << results[i] << "\n";
+        ++success;
+    }
+
+    out.close();
+
+    cout << success << " / " << n << " : "
+         << (n > 0 ? (success * 100.0) / n : 0.0) << "% ("
+         << setprecision(4) << time << " seconds, "
+         << (n > 0 ? time / n : 0.0) << " s / hash)" << endl;
+
+    return time;
+}
+
+bool RainbowHacking::checkLength(int pwdLen) const {
+    Keyspace keyspace(string(), 0);
+
+    if (pwdLen < 1 || pwdLen > MAX_PWD_SIZE) {
+        cerr << "Expected a password length from 1 to " << MAX_PWD_SIZE << "." << endl;
+        return false;
+    }
+    if (_options.minLen > (unsigned int) pwdLen) {
+        cerr << "The minimum length " << _options.minLen << " is longer than the passwords." << endl;
+        return false;
+    }
+    if (!Keyspace::create(_charset, _options.mask, _options.minLen, pwdLen, keyspace)) {
+        cerr << "The mask has fewer than " << pwdLen << " positions." << endl;
+        return false;
+    }
+    if (!keyspace.uniform() && keyspace.size() == 0) {
+        cerr << "The mask and the length range have more than 2^64 passwords." << endl;
+        return false;
+    }
+
+    return true;
+}
+
 double RainbowHacking::newTable() {
 
-    delete _rain;
+    clearTables();
 
     int chainLen, nChains, pwdLen;
-    string ll(LETTERSLOWER);
-    string lu(LETTERSUPPER);
-    string d(DIGITS);
 
-    string chars = ll + lu + d;
-    HashMethod *hashMethod = new MD5Hash();
     cout << "Enter the length of chains: " << endl;
     cin >> chainLen;
     cout << "Enter the number of chains: " << endl;
     cin >> nChains;
-//    cout << "Enter allowed chars: " << endl;
-//    cin >> chars;
     cout << "Enter the length of password: " << endl;
     cin >> pwdLen;
 
+    if (!checkLength(pwdLen))
+        return 0.0;
+
     cout << "Creating new rainbow table" << endl;
 
     struct timeval t{};
     gettimeofday(&t, nullptr);
 
-    _rain = new RainbowTable(chainLen, nChains, chars, pwdLen, hashMethod);
+    _rain = new RainbowTable(chainLen, nChains, _charset, pwdLen, HashMethod::create(_hashName), _options);
 
     double time = computeTime(t);
     cout << "Table generated (" << setprecision(4) << time << " seconds)" << endl;
@@ -132,9 +302,54 @@ double RainbowHacking::newTable() {
     return time;
 }
 
+double RainbowHacking::buildTable() {
+
+    clearTables();
+
+    int chainLen, pwdLen;
+    uint64_t nChains;
+    string filePath;
+
+    cout << "Enter the length of chains: " << endl;
+    cin >> chainLen;
+    cout << "Enter the number of chains: " << endl;
+    cin >> nChains;
+    cout << "Enter the length of password: " << endl;
+    cin >> pwdLen;
+    cout << "Enter the path" << endl;
+    cout << ">>> ";
+    cin >> filePath;
+
+    if (!checkLength(pwdLen))
+        return 0.0;
+
+    cout << "Building table out of core (" << _options.memoryBudget / 1048576 << " MB)" << endl;
+
+    struct timeval t{};
+    gettimeofday(&t, nullptr);
+
+    long written;
+    {
+        // Only the parameters are kept in memory, the chains going to the file.
+        RainbowTable builder(chainLen, 0, _charset, pwdLen, HashMethod::create(_hashName), _options);
+        written = builder.buildFile(filePath, nChains, _options.memoryBudget);
+    }
+
+    double time = computeTime(t);
+
+    if (written < 0)
+        return time;
+
+    cout << "Table built (" << setprecision(4) << time << " seconds)" << endl;
+
+    loadTable(filePath);
+
+    return time;
+}
+
 double RainbowHacking::loadTable(std::string const &filePath) {
 
-    delete _rain;
+    clearTables();
 
     struct timeval t{};
     gettimeofday(&t, nullptr);
@@ -142,11 +357,56 @@ double RainbowHacking::loadTable(std::string const &filePath) {
     _rain = new RainbowTable(filePath);
 
     double time = computeTime(t);
+
+    if (!_rain->isLoaded()) {
+        delete _rain;
+        _rain = nullptr;
+        return time;
+    }
+
     cout << "Table loaded (" << setprecision(4) << time << " seconds)" << endl;
 
     return time;
 }
 
+double RainbowHacking::addTable(std::string const &filePath) {
+
+    struct timeval t{};
+    gettimeofday(&t, nullptr);
+
+    auto *table = new RainbowTable(filePath);
+
+    double time = computeTime(t);
+
+    if (!table->isLoaded() || !tables().add(table)) {
+        delete table;
+        return time;
+    }
+
+    _others.push_back(table);
+
+    cout << "Table added (" << setprecision(4) << time << " seconds), "
+         << _others.size() + 1 << " tables in the set." << endl;
+
+    return time;
+}
+
+double RainbowHacking::convertTable(std::string const &sourcePath, std::string const &destinationPath) {
+
+    struct timeval t{};
+    gettimeofday(&t, nullptr);
+
+    RainbowTable table(sourcePath);
+
+    if (table.isLoaded())
+        table.writeToFile(destinationPath);
+
+    double time = computeTime(t);
+    cout << "Table converted (" << setprecision(4) << time << " seconds)" << endl;
+
+    return time;
+}
+
 double RainbowHacking::extendTable() {
 
     unsigned int nChains;
@@ -165,6 +425,124 @@ double RainbowHacking::extendTable() {
     return time;
 }
 
+void RainbowHacking::setOption(std::string const &option, std::string const &value) {
+
+    if (option == "checkpoints") {
+        vector<unsigned int> columns;
+
+        if (value == "none") {
+            _options.checkpoints.clear();
+        } else if (TextTableFile::parseList(value, columns) && columns.size() <= MAX_CHECKPOINTS) {
+            _options.checkpoints = columns;
+        } else {
+            cerr << "Expected at most " << MAX_CHECKPOINTS << " comma separated columns, or 'none'." << endl;
+            return;
+        }
+    } else if (option == "perfect") {
+        if (value != "0" && value != "1") {
+            cerr << "Expected 0 or 1." << endl;
+            return;
+        }
+        _options.perfect = value == "1";
+    } else if (option == "dp") {
+        vector<unsigned int> bits;
+
+        if (!TextTableFile::parseList(value, bits) || bits.size() != 1 || bits[0] > MAX_DP_BITS) {
+            cerr << "Expected a number of bits from 0 to " << MAX_DP_BITS << "." << endl;
+            return;
+        }
+        _options.dpBits = bits[0];
+    } else if (option == "table") {
+        vector<unsigned int> index;
+
+        if (!TextTableFile::parseList(value, index) || index.size() != 1) {
+            cerr << "Expected the index of the table in its set." << endl;
+            return;
+        }
+        _options.tableIndex = index[0];
+    } else if (option == "filter") {
+        vector<unsigned int> bits;
+
+        if (!TextTableFile::parseList(value, bits) || bits.size() != 1 || bits[0] > BLOOM_MAX_BITS_PER_KEY) {
+            cerr << "Expected a number of bits per chain from 0 to " << BLOOM_MAX_BITS_PER_KEY << "." << endl;
+            return;
+        }
+        _options.filterBits = bits[0];
+    } else if (option == "directory") {
+        if (value != "0" && value != "1") {
+            cerr << "Expected 0 or 1." << endl;
+            return;
+        }
+        _options.directory = value == "1";
+    } else if (option == "seed" || option == "first") {
+        uint64_t number;
+
+        if (!TextTableFile::parseNumber(value, number)) {
+            cerr << "Expected a number." << endl;
+            return;
+        }
+        if (option == "seed")
+            _options.seed = number;
+        else
+            _options.firstStart = number;
+    } else if (option == "hash") {
+        HashMethod *hashMethod = HashMethod::create(value);
+
+        if (!hashMethod) {
+            cerr << "Expected one of: " << HashMethod::names() << "." << endl;
+            return;
+        }
+        delete hashMethod;
+        _hashName = value;
+    } else if (option == "reduction") {
+        if (!Reduction::parse(value, _options.reduction)) {
+            cerr << "Expected bytes, index or keyspace." << endl;
+            return;
+        }
+    } else if (option == "charset") {
+        string chars;
+
+        if (!Keyspace::parseCharset(value, chars)) {
+            cerr << "Expected characters, ?l, ?u, ?d, ?s or ?a." << endl;
+            return;
+        }
+        _charset = chars;
+    } else if (option == "mask") {
+        vector<string> charsets;
+
+        if (value == "none") {
+            _options.mask.clear();
+        } else if (Keyspace::parseMask(value, charsets) && value.size() < TABLE_FILE_MAX_MASK) {
+            _options.mask = value;
+        } else {
+            cerr << "Expected at most " << MAX_PWD_SIZE << " positions of ?l, ?u, ?d, ?s, ?a or a character,"
+                 << " or 'none'." << endl;
+            return;
+        }
+    } else if (option == "minLen") {
+        vector<unsigned int> len;
+
+        if (!TextTableFile::parseList(value, len) || len.size() != 1 || len[0] > MAX_PWD_SIZE) {
+            cerr << "Expected a length from 0 to " << MAX_PWD_SIZE << "." << endl;
+            return;
+        }
+        _options.minLen = len[0];
+    } else if (option == "memory") {
+        vector<unsigned int> megabytes;
+
+        if (!TextTableFile::parseList(value, megabytes) || megabytes.size() != 1 || megabytes[0] == 0) {
+            cerr << "Expected a number of megabytes." << endl;
+            return;
+        }
+        _options.memoryBudget = (size_t) megabytes[0] * 1048576;
+    } else {
+        cerr << option << " is not a valid option." << endl;
+        return;
+    }
+
+    cout << option << " set to " << value << " for the next tables." << endl;
+}
+
 double RainbowHacking::generatePwdFile(int n, std::string const &filePath) {
 
     struct timeval t{};
@@ -239,6 +617,163 @@ double RainbowHacking::testPwdFile(std::string const &filePath) {
     return time;
 }
 
+void RainbowHacking::benchmark() const {
+    const unsigned long nSteps = 20000000;
+
+    cout << "Chain steps, one chain at a time: "
+         << setprecision(4) << Benchmark::chainSteps(*_rain, nSteps) << " steps / s" << endl;
+    cout << "Chain steps, " << CHAIN_BATCH << " chains in lockstep: "
+         << setprecision(4) << Benchmark::chainStepsBatch(*_rain, nSteps) << " steps / s" << endl;
+    cout << "End hash lookups missing the table: "
+         << setprecision(4) << Benchmark::missLookups(*_rain, 1000000) << " lookups / s" << endl;
+    cout << "End hash lookups missing the table, " << LOOKUP_BATCH << " at a time: "
+         << setprecision(4) << Benchmark::missLookupsBatch(*_rain, 1000000) << " lookups / s" << endl;
+
+    // Hash cracking latency, from one thread to all of them.
+    const unsigned int nHashes = 50;
+    const int maxThreads = max(omp_get_num_procs(), omp_get_max_threads());
+    double single = 0.0;
+
+    for (int nThreads = 1; ; nThreads = min(2 * nThreads, maxThreads)) {
+        double latency = Benchmark::crackLatency(*_rain, nHashes, nThreads);
+        if (nThreads == 1)
+            single = latency;
+
+        cout << "Crack latency, " << nThreads << " threads: "
+             << setprecision(4) << latency << " s / hash (x" << single / latency << ")" << endl;
+
+        if (nThreads == maxThreads)
+            break;
+    }
+}
+
+void RainbowHacking::coverage() const {
+    int chainLen, nChains, pwdLen;
+
+    cout << "Enter the length of chains: " << endl;
+    cin >> chainLen;
+    cout << "Enter the number of chains: " << endl;
+    cin >> nChains;
+    cout << "Enter the length of password: " << endl;
+    cin >> pwdLen;
+
+    if (!checkLength(pwdLen))
+        return;
+
+    const unsigned int nHashes = 1000;
+    TableOptions options = _options;
+
+    // Distinguished point chains do not have a fixed length.
+    if (_options.dpBits == 0) {
+        Keyspace keyspace(string(), 0);
+        Keyspace::create(_charset, _options.mask, _options.minLen, pwdLen, keyspace);
+
+        TablePlan expected = TablePlanner::evaluate(TablePlanner::keyspaceSize(keyspace), chainLen, nChains, 1,
+                                                    _options.perfect, bytesPerChain(pwdLen));
+
+        if (_options.perfect)
+            cout << "model: " << setprecision(6) << expected.nStored << " distinct end hashes of "
+                 << setprecision(6) << expected.nChains << " chains generated, ";
+        else
+            cout << "model: " << setprecision(4) << 100.0 * expected.uniqueEnds << "% distinct end hashes, ";
+        cout << setprecision(4) << 100.0 * expected.success << "% of hashes cracked" << endl;
+    }
+
+    for (unsigned int reduction = 0; reduction < REDUCE_COUNT; ++reduction) {
+        options.reduction = reduction;
+
+        struct timeval t{};
+        gettimeofday(&t, nullptr);
+
+        RainbowTable table(chainLen, nChains, _charset, pwdLen, HashMethod::create(_hashName), options);
+
+        double time = computeTime(t);
+
+        cout << Reduction::name(reduction) << ": "
+             << setprecision(4) << 100.0 * Benchmark::uniqueEnds(table) << "% distinct end hashes, "
+             << setprecision(4) << 100.0 * Benchmark::successRate(table, nHashes) << "% of " << nHashes
+             << " hashes cracked (" << setprecision(4) << time << " seconds to generate)" << endl;
+    }
+}
+
+double RainbowHacking::bytesPerChain(unsigned int pwdLen) const {
+    return sizeof(Endpoint) + pwdLen + (_options.checkpoints.size() + _options.filterBits) / 8.0
+           + (_options.directory ? 1.0 : 0.0);
+}
+
+void RainbowHacking::printPlan(TablePlan const &plan, double stepsPerSecond) {
+    const int nThreads = omp_get_max_threads();
+    const double rate = stepsPerSecond * nThreads;
+
+    cout << "  " << plan.nTables << " table(s) of " << setprecision(6) << plan.nStored
+         << " chains of length " << plan.chainLen;
+    if (plan.nStored < plan.nChains)
+        cout << ", " << setprecision(6) << plan.nChains << " chains generated per table";
+    cout << endl;
+    cout << "  Success: " << setprecision(4) << 100.0 * plan.success << "% ("
+         << setprecision(4) << 100.0 * plan.coverage << "% per table)" << endl;
+    cout << "  Distinct end hashes: " << setprecision(4) << 100.0 * plan.uniqueEnds
+         << "% of the chains generated, the others merging" << endl;
+    cout << "  Memory: " << setprecision(4) << plan.memory / 1048576 << " MB" << endl;
+    cout << "  Precomputation: " << setprecision(4) << plan.precomputation << " chain steps ("
+         << setprecision(4) << plan.precomputation / rate << " seconds)" << endl;
+    cout << "  Lookup: " << setprecision(4) << plan.worstLookup << " chain steps at worst ("
+         << setprecision(4) << plan.worstLookup / rate << " seconds), "
+         << setprecision(4) << plan.averageLookup << " on average ("
+         << setprecision(4) << plan.averageLookup / rate << " seconds), "
+         << setprecision(4) << plan.falseAlarms << " false alarms per hash not found" << endl;
+    cout << "  Times at " << setprecision(4) << stepsPerSecond << " chain steps / s per thread, on "
+         << nThreads << " threads." << endl;
+}
+
+void RainbowHacking::plan() const {
+    unsigned int nTables, megabytes;
+    double percent;
+    int pwdLen;
+
+    cout << "Enter the number of tables: " << endl;
+    cin >> nTables;
+    cout << "Enter the memory of all the tables, in MB: " << endl;
+    cin >> megabytes;
+    cout << "Enter the success rate, in %: " << endl;
+    cin >> percent;
+    cout << "Enter the length of password: " << endl;
+    cin >> pwdLen;
+
+    if (!cin || nTables == 0 || percent <= 0.0 || percent >= 100.0) {
+        cerr << "Expected at least one table and a success rate between 0 and 100%." << endl;
+        cin.clear();
+        return;
+    }
+    if (!checkLength(pwdLen))
+        return;
+
+    Keyspace keyspace(string(), 0);
+    Keyspace::create(_charset, _options.mask, _options.minLen, pwdLen, keyspace);
+
+    const double n = TablePlanner::keyspaceSize(keyspace);
+    TablePlan plan{};
+    bool reached = TablePlanner::recommend(n, nTables, megabytes * 1048576.0, percent / 100.0, _options.perfect,
+                                           bytesPerChain(pwdLen), plan);
+
+    cout << "Keyspace: " << setprecision(6) << n << " passwords" << endl;
+
+    if (plan.nStored < 1.0) {
+        cout << "The memory does not hold a single chain per table." << endl;
+        return;
+    }
+
+    // The speed of the chain walk of these parameters, on a table without chains.
+    RainbowTable table(plan.chainLen, 0, _charset, pwdLen, HashMethod::create(_hashName), _options);
+    double stepsPerSecond = Benchmark::chainStepsBatch(table, 2000000);
+
+    cout << (reached ? "Recommended:" : "The success rate cannot be reached with this memory, the best is:") << endl;
+    printPlan(plan, stepsPerSecond);
+
+    if (!reached)
+        cout << "More memory or more tables would raise the success rate." << endl;
+}
+
 void RainbowHacking::doAction(const string& action) {
     string param1;
     string filePath;
@@ -252,16 +787,55 @@ void RainbowHacking::doAction(const string& action) {
     else if (action == "new") { /* Create a new table. */
         newTable();
     }
+    else if (action == "build") { /* Build a table into a file, out of core. */
+        buildTable();
+    }
+    else if (action == "set") { /* Set a build option. */
+        cout << "Enter the option" << endl;
+        cout << ">>> ";
+        cin >> param1;	// Option name
+        cout << "Enter the value" << endl;
+        cout << ">>> ";
+        cin >> filePath;	// Option value
+        setOption(param1, filePath);
+    }
     else if (action == "load") { /* Load a table from a file. */
         cout << "Enter the path" << endl;
         cout << ">>> ";
         cin >> param1;	// File name
         loadTable(param1);
     }
+    else if (action == "convert") { /* Convert a table file, without loading it as the current table. */
+        cout << "Enter the source path" << endl;
+        cout << ">>> ";
+        cin >> param1;	// Source file name
+        cout << "Enter the destination path" << endl;
+        cout << ">>> ";
+        cin >> filePath;	// Destination file name
+        convertTable(param1, filePath);
+    }
+    else if (action == "coverage") { /* Compare the reduction functions, on new tables. */
+        coverage();
+    }
+    else if (action == "plan") { /* Recommend the parameters of new tables. */
+        plan();
+    }
+    else if (action == "verify") { /* Check a binary table file. */
+        cout << "Enter the path" << endl;
+        cout << ">>> ";
+        cin >> param1;	// File name
+        cout << (TableFile::verify(param1) ? "The table file is intact." : "The table file is corrupted.") << endl;
+    }
     else if (_rain == nullptr && action != "quit") {
         /* If the table has not yet been initialized, interrupt. */
         cout << "***You need to create or load a table first." << endl;
     }
+    else if (action == "addTable") { /* Load a table into the set of the current one. */
+        cout << "Enter the path" << endl;
+        cout << ">>> ";
+        cin >> param1;	// File name
+        addTable(param1);
+    }
     else if (action == "crackH") {  /* Crack a hash. */
         cout << "Enter a hash" << endl;
         cout << ">>> ";
@@ -274,6 +848,15 @@ void RainbowHacking::doAction(const string& action) {
         cin >> param1;	// Word to hash, and then to crack.
         crackWord(param1, res);
     }
+    else if (action == "crackF") { /* Crack a file of hashes. */
+        cout << "Enter the path of the hashes" << endl;
+        cout << ">>> ";
+        cin >> param1;	// File name
+        cout << "Enter the path of the results" << endl;
+        cout << ">>> ";
+        cin >> filePath;	// File name
+        crackHashFile(param1, filePath);
+    }
     else if (action == "save") { /* Save the current table to a file. */
         cout << "Enter the path" << endl;
         cout << ">>> ";
@@ -283,6 +866,12 @@ void RainbowHacking::doAction(const string& action) {
     else if (action == "addChain") {
         extendTable();
     }
+    else if (action == "compact") { /* Store the current table as a compact index. */
+        cout << "Enter the number of end hash bits to keep" << endl;
+        cout << ">>> ";
+        cin >> n; // Bits per end hash
+        _rain->compactTable(n);
+    }
     else if (action == "genPwd") { /* Generate a password file. */
         cout << "Enter a number" << endl;
         cout << ">>> ";
@@ -298,6 +887,9 @@ void RainbowHacking::doAction(const string& action) {
         cin >> param1; // File name
         testPwdFile(param1);
     }
+    else if (action == "bench") { /* Measure the throughput of the current table. */
+        benchmark();
+    }
     else if (action != "quit") {
         /* Invalid command. */
         cout << action << " is not a valid command." << endl;
@@ -309,7 +901,8 @@ void RainbowHacking::doAction(const string& action) {
 
 void RainbowHacking::handleSignalCTRLC(int signal)
 {
-    delete *(RainbowHacking::_rainInstance);
+    // Same cleanup as quit: _rain and every table added to the set.
+    RainbowHacking::_instance->clearTables();
     cout << "Received signal: " << signal << endl;
     exit(EXIT_SUCCESS);
 }
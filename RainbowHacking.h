@@ -6,8 +6,11 @@
 #define RAINBOWHACKING_RAINBOWHACKING_H
 
 #include "RainbowTable.h"
+#include "TableSet.h"
+#include "TablePlanner.h"
 #include <sys/time.h>
 #include <string>
+#include <vector>
 
 class RainbowHacking {
 
@@ -32,9 +35,21 @@ private:
     /* Rainbow table */
     RainbowTable* _rain;
 
-    /* Static pointer to _rain. Used so that static method handleSignalCTRLC
-    can free memory when user interrupts the execution. */
-    static RainbowTable** _rainInstance;
+    /* Tables added with addTable, looked up along with _rain */
+    std::vector<RainbowTable *> _others;
+
+    /* Build options of the next tables */
+    TableOptions _options;
+
+    /* Name of the hashing method of the next tables */
+    std::string _hashName;
+
+    /* Characters of the passwords of the next tables, at every position not set by a mask */
+    std::string _charset;
+
+    /* Static pointer to the instance. Used so that static method handleSignalCTRLC
+    can free the tables when user interrupts the execution. */
+    static RainbowHacking* _instance;
 
     /***************** Methods *****************/
     /**
@@ -49,6 +64,16 @@ private:
      */
     static double computeTime(struct timeval const &t0) ;
 
+    /**
+     * @return the set of the current table and the tables added to it.
+     */
+    TableSet tables() const;
+
+    /**
+     * Deletes the current table and the tables added to it.
+     */
+    void clearTables();
+
     double crackHash(std::string const &hash, bool &hasFound) const;
 
     /**
@@ -59,12 +84,34 @@ private:
      */
     double crackWord(std::string const &pwd, bool &hasFound) const;
 
+    /**
+     * Cracks all the hashes of a file at once.
+     * @param hashPath: Path of the file of hashes, one per line.
+     * @param resultPath: Path of the file to write the hashes found to, with their password.
+     * @return The time the operation took.
+     */
+    double crackHashFile(std::string const &hashPath, std::string const &resultPath) const;
+
+    /**
+     * Checks that the next tables can have passwords of <pwdLen> characters
+     * with the current charset, mask and minimum length.
+     * @return false, with an error, if they cannot.
+     */
+    bool checkLength(int pwdLen) const;
+
     /**
      * Creates a new table, using the user inputted arguments.
      * Returns the time the operation took.
      */
     double newTable();
 
+    /**
+     * Builds a table straight into a binary table file, within the memory
+     * budget of the build options, then loads it.
+     * @return the time the operation took.
+     */
+    double buildTable();
+
     /**
      * Loads a table from a file.
      * @param fileName: Path of the file to read in.
@@ -72,12 +119,34 @@ private:
      */
     double loadTable(std::string const &filePath);
 
+    /**
+     * Loads a table from a file, to be looked up along with the current one.
+     * @param filePath: Path of the file to read in.
+     * @return the time the operation took.
+     */
+    double addTable(std::string const &filePath);
+
+    /**
+     * Converts a table file to another format, leaving the current table untouched.
+     * @param sourcePath: Path of the file to read.
+     * @param destinationPath: Path of the file to write. Its extension selects the format.
+     * @return the time the operation took.
+     */
+    double convertTable(std::string const &sourcePath, std::string const &destinationPath);
+
     /**
      * 
      * @return
      */
     double  extendTable();
 
+    /**
+     * Sets a build option of the next tables.
+     * @param option: Name of the option.
+     * @param value: Value of the option.
+     */
+    void setOption(std::string const &option, std::string const &value);
+
     /**
      * Generates a file containing valid random passwords.
      * @param n: Number of passwords to generate.
@@ -93,6 +162,35 @@ private:
      */
     double testPwdFile(std::string const &filePath);
 
+    /**
+     * Measures the chain steps per second with the parameters of the current table,
+     * and how the time to crack a hash scales with the number of threads.
+     */
+    void benchmark() const;
+
+    /**
+     * Builds a table with the same parameters and options for every reduction
+     * function, and compares their part of distinct end hashes and success rates.
+     */
+    void coverage() const;
+
+    /**
+     * Recommends the parameters of a set of tables, from the keyspace of the
+     * current charset, mask and lengths, a memory budget and a success rate.
+     */
+    void plan() const;
+
+    /**
+     * Prints the expected results and costs of a set of tables.
+     * @param stepsPerSecond: Chain steps per second of a thread, to turn the costs into times.
+     */
+    static void printPlan(TablePlan const &plan, double stepsPerSecond);
+
+    /**
+     * @return the memory of a chain of the next tables of passwords of <pwdLen> characters.
+     */
+    double bytesPerChain(unsigned int pwdLen) const;
+
     /**
      * Handles the CTRL-C (interruption) signal.
      * @param signal
@@ -10,22 +10,46 @@
 
 #include "RainbowTable.h"
 #include "TableBuilder.hpp"
+#include "TableFile.h"
+#include "TextTableFile.h"
 #include <random>
 #include <omp.h>
 #include <iostream>
 #include <cstring>
+#include <algorithm>
 
 RainbowTable::RainbowTable(std::string const &filePath) {
     this->initFromFile(filePath);
 }
 
 RainbowTable::RainbowTable(unsigned int chainLen, unsigned int nChains, std::string const &domain,
-                           unsigned int pwdLen, HashMethod* hashMethod)
+                           unsigned int pwdLen, HashMethod* hashMethod, TableOptions const &options)
 {
     this->chainLen = chainLen;
     this->domain = domain;
     this->pwdLen = pwdLen;
     this->hashMethod = hashMethod;
+    this->checkpoints = options.checkpoints;
+    this->perfect = options.perfect;
+    this->dpBits = options.dpBits < MAX_DP_BITS ? options.dpBits : MAX_DP_BITS;
+    this->tableIndex = options.tableIndex;
+    this->reduction = options.reduction < REDUCE_COUNT ? options.reduction : REDUCE_BYTES;
+    this->filterBits = options.filterBits < BLOOM_MAX_BITS_PER_KEY ? options.filterBits : BLOOM_MAX_BITS_PER_KEY;
+    this->directory = options.directory;
+    this->mask = options.mask;
+    this->minLen = options.minLen;
+    initKeyspace();
+    this->seed = keyspace.size() > 0 ? options.seed % keyspace.size() : options.seed;
+    this->nextStart = options.firstStart;
+
+    // The column of a hash in a distinguished point chain is not known at lookup.
+    if (dpBits > 0 && !checkpoints.empty()) {
+        std::cerr << "Checkpoints do not apply to a distinguished point table, ignored." << std::endl;
+        checkpoints.clear();
+    }
+
+    initCheckpoints();
+    initKernel();
 //    replace(chars, "a-z", LETTERSLOWER);
 //    replace(chars, "A-Z", LETTERSUPPER);
 //    replace(chars, "0-9", DIGITS);
@@ -34,79 +58,389 @@ RainbowTable::RainbowTable(unsigned int chainLen, unsigned int nChains, std::str
 }
 
 RainbowTable::~RainbowTable() {
+    delete kernel;
     delete hashMethod;
     delete table;
 }
 
+void RainbowTable::initKeyspace() {
+    if (!Keyspace::create(domain, mask, minLen, pwdLen, keyspace)) {
+        std::cerr << "Invalid mask for passwords of " << pwdLen << " characters, ignored." << std::endl;
+        mask.clear();
+        Keyspace::create(domain, mask, minLen, pwdLen, keyspace);
+    }
+
+    // A keyspace reduction cannot index more than 2^64 passwords.
+    if (!keyspace.uniform() && keyspace.size() == 0) {
+        std::cerr << "The keyspace is too large for 64 bits, the mask and the length range are ignored." << std::endl;
+        mask.clear();
+        keyspace = Keyspace(domain, pwdLen);
+    }
+
+    this->minLen = keyspace.minLen();
+    this->domain = keyspace.domain();
+
+    if (keyspace.uniform()) {
+        // A mask of a single charset is the domain.
+        mask.clear();
+        if (reduction == REDUCE_KEYSPACE && keyspace.size() == 0) {
+            std::cerr << "The keyspace is too large for the keyspace reduction, the index reduction is used." << std::endl;
+            reduction = REDUCE_INDEX;
+        }
+    } else if (reduction != REDUCE_KEYSPACE) {
+        std::cout << "Passwords of several lengths or charsets: the keyspace reduction is used." << std::endl;
+        reduction = REDUCE_KEYSPACE;
+    }
+}
+
+void RainbowTable::initKernel() {
+    delete kernel;
+    kernel = ChainKernel::create(hashMethod, keyspace, chainLen, tableIndex, reduction);
+}
+
+void RainbowTable::initCheckpoints() {
+    std::sort(checkpoints.begin(), checkpoints.end());
+    checkpoints.erase(std::unique(checkpoints.begin(), checkpoints.end()), checkpoints.end());
+
+    while (!checkpoints.empty() && checkpoints.back() >= chainLen)
+        checkpoints.pop_back();
+
+    if (checkpoints.size() > MAX_CHECKPOINTS)
+        checkpoints.resize(MAX_CHECKPOINTS);
+
+    checkpointOf.assign(chainLen, -1);
+    knownChecks.assign(chainLen, 0);
+
+    for (unsigned int c = 0; c < checkpoints.size(); ++c)
+        checkpointOf[checkpoints[c]] = c;
+
+    // Walking from column k meets the checkpoints of the columns k and above.
+    uint64_t known = 0;
+
+    for (long k = (long) chainLen - 1; k >= 0; --k) {
+        if (checkpointOf[k] >= 0)
+            known |= (uint64_t) 1 << checkpointOf[k];
+        knownChecks[k] = known;
+    }
+}
+
 void RainbowTable::generateChains(unsigned int nChains, Table *rainbowTable) {
 
+    if (!perfect || nChains == 0) {
+        this->table = appendChains(nChains, rainbowTable);
+        return;
+    }
+
+    const size_t initial = rainbowTable ? rainbowTable->size() : 0;
+    const size_t target = initial + nChains;
+    unsigned long generated = 0;
+    unsigned int toGenerate = nChains;
+
+    Table *current = rainbowTable;
+
+    for (int round = 0; ; ++round) {
+        size_t before = current ? current->size() : 0;
+
+        current = appendChains(toGenerate, current);
+        generated += toGenerate;
+
+        if (current->size() >= target)
+            break;
+
+        // Part of the latest chains which did not merge, which only drops as
+        // the table fills, to estimate how many more chains are needed.
+        // A perfect table cannot hold more than about 2 * keyspace / (chainLen + 2)
+        // chains, and gets closer to it slower and slower.
+        double kept = (double) (current->size() - before) / toGenerate;
+
+        if (kept < 0.01 || round == 64) {
+            std::cerr << "The table is saturated: stopped at " << current->size() << " distinct end hashes." << std::endl;
+            break;
+        }
+
+        double estimate = (target - current->size()) / kept * 1.05 + 64;
+        toGenerate = estimate < 4.0 * target ? (unsigned int) estimate : 4 * target;
+    }
+
+    this->table = current;
+
+    std::cout << "Perfect table: " << generated << " chains generated, " << table->size() - initial
+              << " distinct end hashes kept (merge rate " << 100.0 * (1.0 - (double) (table->size() - initial) / generated)
+              << "%)" << std::endl;
+}
+
+Table *RainbowTable::appendChains(unsigned int nChains, Table *rainbowTable, bool indexed) {
+
+    if (dpBits > 0)
+        return appendDPChains(nChains, rainbowTable, indexed);
+
     const int nThreads = omp_get_max_threads();
 
     omp_set_num_threads(nThreads);
 
-    std::vector<Chain*> v_arr[nThreads];
+    TableBuilder tableBuilder(nChains, pwdLen, rainbowTable, checkpoints.size());
+    tableBuilder.setPerfect(perfect)->setFilter(indexed ? filterBits : 0)->setDirectory(indexed && directory, dpBits);
+
+    // Rows of the new chains. Every thread fills its own range of rows.
+    const size_t first = tableBuilder.append(nChains);
+
+    // Start indices of the new chains, whatever the thread generating them.
+    const uint64_t firstStart = nextStart;
+    nextStart += nChains;
 
-    // Will crash if nChains < 55
     const unsigned int chunkSize = (nChains + nThreads - 1) / nThreads;
 
     // Parallelize the generation.
     // Every thread will generates <nChains / # of threads> chains.
-    #pragma omp parallel default(none) shared(nChains, chunkSize, v_arr)
+    #pragma omp parallel default(none) shared(nChains, chunkSize, first, firstStart, tableBuilder)
     {
-        std::string pwd;
-        unsigned char hash[HASH_SIZE];
+        Password startPwds[CHAIN_BATCH];
+        Password pwds[CHAIN_BATCH];
+        unsigned char hashes[CHAIN_BATCH * HASH_SIZE];
+        uint64_t checks[CHAIN_BATCH];
 
         int threadNum = omp_get_thread_num(); // Get thread number
 
         long start = threadNum * chunkSize;
         long end = start + chunkSize < nChains ? start + chunkSize : nChains;
 
-        v_arr[threadNum].reserve(end - start);
+        for (long i = start; i < end; i += CHAIN_BATCH) {
+            unsigned int n = end - i < CHAIN_BATCH ? end - i : CHAIN_BATCH;
+
+            // Derive the start passwords from the indices of the chains.
+            for (unsigned int j = 0; j < n; ++j)
+                startPassword(firstStart + i + j, startPwds[j]);
 
-        for (long i = start; i < end; ++i) {
-            // Generate a new password
-            pwd = randomPassword();
-            // Generate a chain, and retrieve its last hash.
-            createChain(pwd, hash);
+            // Generate the chains together, and retrieve their last hashes.
+            memcpy(pwds, startPwds, n * sizeof(Password));
+            createChains(pwds, n, hashes, checks);
 
-            // Add the pair password - hash to a temporary vector.
-            auto *chain = new Chain(pwd, hash);
-            v_arr[threadNum].push_back(chain);
+            // Store the pairs password - hash in the table.
+            for (unsigned int j = 0; j < n; ++j)
+                tableBuilder.set(first + i + j, startPwds[j], hashes + j * HASH_SIZE, checks[j]);
         }
     }
 
-    TableBuilder tableBuilder(nChains, rainbowTable);
+    return tableBuilder.build();
+}
+
+Table *RainbowTable::appendDPChains(unsigned int nChains, Table *rainbowTable, bool indexed) {
+
+    const int nThreads = omp_get_max_threads();
+
+    // Chains kept by every thread, gathered in the table afterwards, since
+    // the number of chains to start for <nChains> to end is not known.
+    std::vector<std::vector<Password>> starts(nThreads);
+    std::vector<std::vector<unsigned char>> ends(nThreads);
+    std::atomic<unsigned int> kept(0);
+    std::atomic<unsigned long> started(0);
+    std::atomic<bool> tooShort(false);
+    std::atomic<uint64_t> counter(nextStart);
+
+    #pragma omp parallel default(none) shared(nChains, starts, ends, kept, started, tooShort, counter)
+    {
+        int threadNum = omp_get_thread_num();
+        std::vector<Password> &threadStarts = starts[threadNum];
+        std::vector<unsigned char> &threadEnds = ends[threadNum];
+
+        while (kept.load(std::memory_order_relaxed) < nChains && !tooShort.load(std::memory_order_relaxed)) {
+            size_t size = threadStarts.size();
 
-    // Add the pairs in the temporary vector to the table.
-    for (int i = 0; i < nThreads; ++i) {
-        while (!v_arr[i].empty()) {
-            tableBuilder.insert(v_arr[i].back());
-            v_arr[i].pop_back();
+            threadStarts.resize(size + DP_CHAIN_BLOCK);
+            threadEnds.resize((size + DP_CHAIN_BLOCK) * HASH_SIZE);
+
+            uint64_t firstStart = counter.fetch_add(DP_CHAIN_BLOCK);
+            unsigned int found = createDPChains(DP_CHAIN_BLOCK, firstStart, &threadStarts[size],
+                                                &threadEnds[size * HASH_SIZE]);
+
+            threadStarts.resize(size + found);
+            threadEnds.resize((size + found) * HASH_SIZE);
+            started += DP_CHAIN_BLOCK;
+            kept += found;
+
+            // Not a single chain of a whole block ended: chainLen is far too short.
+            if (found == 0)
+                tooShort = true;
         }
     }
 
-    this->table = tableBuilder.build();
+    // The indices of the chains dropped are not used again.
+    nextStart = counter;
+
+    if (tooShort)
+        std::cerr << "Chains of " << chainLen << " hashes hardly ever reach a distinguished point of "
+                  << dpBits << " bits." << std::endl;
+
+    const unsigned int total = kept < nChains ? kept.load() : nChains;
+
+    TableBuilder tableBuilder(total, pwdLen, rainbowTable);
+    tableBuilder.setPerfect(perfect)->setFilter(indexed ? filterBits : 0)->setDirectory(indexed && directory, dpBits);
+
+    size_t row = tableBuilder.append(total);
+    const size_t end = row + total;
+
+    // The last blocks may have ended more chains than needed.
+    for (int t = 0; t < nThreads; ++t) {
+        for (size_t j = 0; j < starts[t].size() && row < end; ++j, ++row)
+            tableBuilder.set(row, starts[t][j], &ends[t][j * HASH_SIZE]);
+    }
+
+    std::cout << "Distinguished points: " << started << " chains started, " << kept
+              << " ended within " << chainLen << " hashes." << std::endl;
+
+    return tableBuilder.build();
 }
 
 void RainbowTable::initTable(unsigned int nChains) {
 
-    std::cout << "Initializing table" << std::endl;
+    std::cout << "Initializing table (" << hashMethod->name() << ", " << MD5Multi::isaName() << " hashing, "
+              << (kernel->specialized() ? "specialized" : "generic") << " chain kernel)" << std::endl;
 
     generateChains(nChains);
 }
 
 void RainbowTable::extendTable(unsigned int nChains) {
 
+    if (table->isCompact()) {
+        std::cerr << "A compact table cannot be extended." << std::endl;
+        return;
+    }
+
     std::cout << "Extending table" << std::endl;
 
     generateChains(nChains, table);
 }
 
+long RainbowTable::buildFile(std::string const &filePath, uint64_t nChains, size_t memoryBudget) {
+
+    if (!TableFile::hasTableExtension(filePath)) {
+        std::cerr << "A table built out of core is written to a " TABLE_FILE_EXTENSION " file." << std::endl;
+        return -1;
+    }
+
+    if (domain.size() > TABLE_FILE_MAX_DOMAIN || hashMethod->name().size() >= TABLE_FILE_MAX_NAME
+        || mask.size() >= TABLE_FILE_MAX_MASK) {
+        std::cerr << "The parameters of the table cannot be written to a file." << std::endl;
+        return -1;
+    }
+
+    TableFileHeader header{};
+    getParameters(header);
+
+    ExternalTableBuilder builder(filePath, header, memoryBudget, perfect, directory);
+
+    const size_t runChains = builder.runChains();
+    unsigned int nRuns = 0;
+    uint64_t generated = 0, toGenerate = nChains;
+    long distinct = 0;
+
+    // Same rounds as generateChains() for a perfect table, the end hashes
+    // kept so far being counted by merging the runs.
+    for (int round = 0; ; ++round) {
+        for (uint64_t done = 0; done < toGenerate; ++nRuns) {
+            auto n = (unsigned int) (toGenerate - done < runChains ? toGenerate - done : runChains);
+
+            // Every run is generated and sorted in memory on its own. Only the
+            // merged file gets a filter and a directory, so the runs do without.
+            Table *run = appendChains(n, nullptr, false);
+            bool ok = builder.addRun(*run);
+            delete run;
+
+            if (!ok)
+                return -1;
+
+            done += n;
+            generated += n;
+            std::cout << "Run " << nRuns + 1 << " spilled: " << generated << " chains generated." << std::endl;
+        }
+
+        if (!perfect)
+            break;
+
+        long before = distinct;
+        distinct = builder.countChains();
+
+        if (distinct < 0)
+            return -1;
+        if ((uint64_t) distinct >= nChains)
+            break;
+
+        double kept = (double) (distinct - before) / toGenerate;
+
+        if (kept < 0.01 || round == 64) {
+            std::cerr << "The table is saturated: stopped at " << distinct << " distinct end hashes." << std::endl;
+            break;
+        }
+
+        double estimate = (nChains - distinct) / kept * 1.05 + 64;
+        toGenerate = estimate < 4.0 * nChains ? (uint64_t) estimate : 4 * nChains;
+    }
+
+    builder.setStartCount(nextStart);
+    long written = builder.finish();
+
+    if (written >= 0)
+        std::cout << "Merged " << nRuns << " runs: " << written << " chains written." << std::endl;
+    if (written >= 0 && perfect)
+        std::cout << "Perfect table: " << generated << " chains generated, " << written
+                  << " distinct end hashes kept (merge rate " << 100.0 * (1.0 - (double) written / generated)
+                  << "%)" << std::endl;
+
+    return written;
+}
+
+void RainbowTable::compactTable(unsigned int suffixBits) {
+
+    if (table->isCompact()) {
+        std::cerr << "The table is already compact." << std::endl;
+        return;
+    }
+
+    if (keyspace.size() == 0) {
+        std::cerr << "The keyspace is too large for a compact table." << std::endl;
+        return;
+    }
+
+    size_t before = table->memoryUsage();
+
+    // The top bits of a distinguished point are all zero, so they select nothing.
+    // Start passwords from a counter are stored as their small index.
+    if (!table->compact(keyspace, suffixBits, dpBits, seed)) {
+        std::cerr << "The table cannot be compacted, it is left as it is." << std::endl;
+        return;
+    }
+
+    std::cout << "Table compacted: " << before / 1048576.0 << " MB -> "
+              << table->memoryUsage() / 1048576.0 << " MB ("
+              << (double) table->memoryUsage() / table->size() << " bytes / chain)" << std::endl;
+}
+
+void RainbowTable::startPassword(uint64_t index, Password &pwd) const {
+    const uint64_t size = keyspace.size();
+
+    // A keyspace too large for 64 bits has more passwords than indices anyway.
+    if (size == 0) {
+        keyspace.unrank(seed + index, pwd);
+        return;
+    }
+
+    index %= size;
+    keyspace.unrank(index < size - seed ? index + seed : index - (size - seed), pwd);
+}
+
 std::string RainbowTable::randomPassword() const {
-    std::random_device rd;  // Seed
-    std::mt19937 mt(rd());  // random number generator
+    // Seeded once per thread, rather than at every call.
+    static thread_local std::mt19937 mt(std::random_device{}());
     std::uniform_int_distribution<> dist(0, domain.size()-1);
 
+    // Passwords of several lengths or charsets, drawn through their index.
+    if (!keyspace.uniform()) {
+        std::uniform_int_distribution<uint64_t> index(0, keyspace.size() - 1);
+        Password pwd;
+        keyspace.unrank(index(mt), pwd);
+        return pwd.str();
+    }
+
     // Generates a new password.
     std::string pwd;
     // Get <pwdLength> random characters from the covered characters, and
@@ -118,185 +452,796 @@ std::string RainbowTable::randomPassword() const {
 }
 
 void RainbowTable::initFromFile(std::string const& filePath) {
-    std::ifstream in(filePath.c_str());
+    TableFileHeader header{};
 
-    if (in) {
-        // Read the parameters from the file.
-        std::string hashMethodName;
+    if (TableFile::isTableFile(filePath)) {
+        this->table = TableFile::open(filePath, header);
+    } else {
+        this->table = TextTableFile::read(filePath, header);
+    }
 
-        in >> this->chainLen;   // Length of the chains.
-        std::cout << "chainLen: " << chainLen << std::endl;
+    if (!table)
+        return;
 
-        unsigned int nChains;
-        in >> nChains;    // Number of chains
-        std::cout << "nChains: " << nChains << std::endl;
+    setParameters(header);
 
-        in >> this->domain;             // Available chars
-        std::cout << "domain: " << domain << std::endl;
+    if (!hashMethod) {
+        std::cerr << "Unknown hashing method <" << header.hashMethod << ">, expected one of: "
+                  << HashMethod::names() << "." << std::endl;
+        delete table;
+        table = nullptr;
+        return;
+    }
 
-        in >> this->pwdLen;	    // Length of the passwords
-        std::cout << "pwdLen: " << pwdLen << std::endl;
+    if (table->isCompact())
+        std::cout << "Compact index, " << header.compactSuffixBits << " bits per end hash." << std::endl;
 
-        in >> hashMethodName;	// Name of the hashing method
-        if (hashMethodName == "md5") {
-            this->hashMethod = new MD5Hash();
-        }
-        std::cout << "hashMethod: " << hashMethodName << std::endl;
+    std::cout << (table->isMapped() ? "Mapped from table file." : "Initialized from file.") << std::endl;
+}
 
-        TableBuilder tableBuilder(nChains);
+void RainbowTable::setParameters(TableFileHeader const &header) {
+    this->chainLen = header.chainLen;   // Length of the chains.
+    std::cout << "chainLen: " << chainLen << std::endl;
 
-        // Read the chains.
-        std::string pwd, hashStr;
-        unsigned char hash[HASH_SIZE];
+    std::cout << "nChains: " << table->size() << std::endl;
 
-        while(in >> pwd >> hashStr) {
-            MD5Hash::hexConvert(hashStr.c_str(), hash);
-            tableBuilder.insert(pwd, hash);
-        }
+    this->domain.assign(header.domain, header.domainLen);   // Available chars
+    std::cout << "domain: " << domain << std::endl;
 
-        this->table = tableBuilder.build();
+    this->pwdLen = header.pwdLen;       // Length of the passwords
+    std::cout << "pwdLen: " << pwdLen << std::endl;
 
-        std::cout << "Initialized from file." << std::endl;
+    this->reduction = header.reduction;
+    if (reduction >= REDUCE_COUNT) {
+        std::cerr << "Invalid reduction function, the table is read with the byte reduction." << std::endl;
+        reduction = REDUCE_BYTES;
+    }
 
-    } else {
-        std::cerr << "Could not read from file \"" << filePath << "\"." << std::endl;
+    this->minLen = header.minLen;
+    this->mask.assign(header.mask, strnlen(header.mask, TABLE_FILE_MAX_MASK));
+    initKeyspace();
+    if (minLen < pwdLen)
+        std::cout << "minLen: " << minLen << std::endl;
+    if (!mask.empty())
+        std::cout << "mask: " << mask << std::endl;
+    if (reduction != REDUCE_BYTES)
+        std::cout << "reduction: " << Reduction::name(reduction) << std::endl;
+
+    this->seed = keyspace.size() > 0 ? header.startSeed % keyspace.size() : header.startSeed;
+    this->nextStart = header.startCount;
+    if (seed > 0)
+        std::cout << "seed: " << seed << std::endl;
+
+    std::string hashMethodName(header.hashMethod);  // Name of the hashing method
+    this->hashMethod = HashMethod::create(hashMethodName);
+    std::cout << "hashMethod: " << hashMethodName << std::endl;
+
+    this->perfect = header.perfect != 0;
+    if (perfect)
+        std::cout << "perfect: 1" << std::endl;
+
+    this->tableIndex = header.tableIndex;
+    if (tableIndex > 0)
+        std::cout << "table: " << tableIndex << std::endl;
+
+    this->dpBits = header.dpBits;
+    if (dpBits > MAX_DP_BITS) {
+        std::cerr << "Invalid distinguished points, the table is read as a rainbow table." << std::endl;
+        dpBits = 0;
     }
-}
+    if (dpBits > 0)
+        std::cout << "dp: " << dpBits << std::endl;
 
-void RainbowTable::writeToFile(std::string const &filePath) const {
-    std::ofstream out(filePath.c_str());
+    this->filterBits = table->getFilterBits();
+    if (filterBits > 0)
+        std::cout << "filter: " << filterBits << std::endl;
 
-    if (out) {
-        // Write the parameters of the table.
-        std::string dstr(domain);
+    this->directory = table->hasDirectory();
+    if (directory)
+        std::cout << "directory: 1" << std::endl;
 
-        out << chainLen << " "  // Length of the chains.
-            << table->size() << " "   // Number of chains
-            << dstr << " "	    // Available chars
-            << pwdLen << " "    // Length of the passwords
-            << hashMethod->name() << std::endl; // Name of the hashing method.
-        // Write the chains.
-        table->printTo(out);
+    initKernel();
 
-        std::cout << "Wrote to file." << std::endl;
+    this->checkpoints.assign(header.checkpoints, header.checkpoints + header.nCheckpoints);
+    initCheckpoints();
 
-    } else {
-        std::cerr << "Could not write to file \"" << filePath << "\"." << std::endl;
+    if (checkpoints.size() != table->getCheckBits()) {
+        std::cerr << "Invalid checkpoints, ignored." << std::endl;
+        checkpoints.clear();
+        initCheckpoints();
     }
 
-    out.close();
+    if (!checkpoints.empty())
+        std::cout << "checkpoints: " << TextTableFile::formatList(checkpoints.data(), checkpoints.size()) << std::endl;
 }
 
-std::string RainbowTable::reduce(unsigned char const *hash, unsigned int k) const {
-    std::string pwd;
-    unsigned int index;
-    // WARNING : Current implementation specific to MD5.
+void RainbowTable::getParameters(TableFileHeader &header) const {
+    header.chainLen = chainLen;
+    header.nChains = table->size();
+    header.pwdLen = pwdLen;
+    header.tableIndex = tableIndex;
+    header.reduction = reduction;
+    header.minLen = minLen < pwdLen ? minLen : 0;
+    memcpy(header.mask, mask.c_str(), mask.size() + 1);
+    header.perfect = perfect;
+    header.dpBits = dpBits;
+    header.filterBits = filterBits;
+    // Set to the bits of the directory of the table written, if any.
+    header.directoryBits = 0;
+    header.directoryZeroBits = dpBits;
+    header.startSeed = seed;
+    header.startCount = nextStart;
+    header.nCheckpoints = checkpoints.size();
+    std::copy(checkpoints.begin(), checkpoints.end(), header.checkpoints);
+    header.domainLen = domain.size();
+    memcpy(header.domain, domain.data(), domain.size());
+    memcpy(header.hashMethod, hashMethod->name().c_str(), hashMethod->name().size() + 1);
+}
 
-    for (int i = 0; i < pwdLen; ++i) {
-        // Get the value of the i-nd byte of the hash. The value column is
-        // added so as to same inputs at different columns will generate a
-        // different reduced password. This will avoid too many repetitions
-        // in the table.
-        index = hash[(i + k) % HASH_SIZE] + k;
-        // Get the corresponding character and concatenate it to the password.
-        pwd += domain[index % domain.size()];
+void RainbowTable::writeToFile(std::string const &filePath) const {
+
+    if (domain.size() > TABLE_FILE_MAX_DOMAIN || hashMethod->name().size() >= TABLE_FILE_MAX_NAME
+        || mask.size() >= TABLE_FILE_MAX_MASK) {
+        std::cerr << "The parameters of the table cannot be written to a file." << std::endl;
+        return;
     }
 
-    return pwd;
+    TableFileHeader header{};
+    getParameters(header);
+
+    if (TableFile::hasTableExtension(filePath)) {
+        if (TableFile::write(filePath, header, *table))
+            std::cout << "Wrote to table file." << std::endl;
+    } else {
+        if (TextTableFile::write(filePath, header, *table))
+            std::cout << "Wrote to file." << std::endl;
+    }
 }
 
-void RainbowTable::createChain(std::string pwd, unsigned char *hash) const {
+void RainbowTable::reduce(unsigned char const *hash, unsigned int k, Password &pwd) const {
+    // Only the first HASH_SIZE bytes of the digest are read, whatever its size.
+
+    // Table t reduces column k like column k + t * chainLen of a single
+    // longer table, on the bytes of the hash xored with t: the tables of a
+    // set use distinct reductions, even where the columns wrap around.
+    if (reduction == REDUCE_KEYSPACE)
+        Reduction::keyspace(hash, k, (uint64_t) tableIndex * chainLen, keyspace, pwd);
+    else
+        Reduction::reduce<0, 0>(reduction, hash, k, (uint64_t) tableIndex * chainLen, tableIndex,
+                                domain.data(), pwdLen, domain.size(), pwd);
+}
+
+void RainbowTable::createChain(Password pwd, unsigned char *hash) const {
     // Hash and reduce the starting password <columns> times.
+    kernel->walk(pwd, hash, 0, chainLen);
+}
+
+void RainbowTable::createChains(Password *pwds, unsigned int n, unsigned char *hashes, uint64_t *checks) const {
+    if (checks)
+        memset(checks, 0, n * sizeof(uint64_t));
+
+    // Hash all the passwords of a column at once, then reduce them.
     for (long i = 0; i < chainLen; ++i) {
-        this->hashPassword(pwd, hash);
-        pwd = this->reduce(hash, i);
+        kernel->hashBatch(pwds, n, hashes);
+
+        if (checks && checkpointOf[i] >= 0) {
+            for (unsigned int j = 0; j < n; ++j)
+                checks[j] |= checkBit(hashes + j * HASH_SIZE) << checkpointOf[i];
+        }
+
+        kernel->reduceBatch(hashes, n, i, pwds);
     }
 }
 
+unsigned int RainbowTable::createDPChains(unsigned int n, uint64_t firstStart, Password *starts,
+                                          unsigned char *hashes) const {
+    Password startPwds[CHAIN_BATCH];
+    Password pwds[CHAIN_BATCH];
+    unsigned int steps[CHAIN_BATCH];
+    unsigned char batchHashes[CHAIN_BATCH * HASH_SIZE];
+
+    unsigned int started = 0, found = 0, active = 0;
+
+    for (; active < CHAIN_BATCH && started < n; ++active, ++started) {
+        startPassword(firstStart + started, startPwds[active]);
+        pwds[active] = startPwds[active];
+        steps[active] = 0;
+    }
+
+    // Every step hashes all the active chains at once, the reduction of
+    // every step being the same one.
+    while (active > 0) {
+        kernel->hashBatch(pwds, active, batchHashes);
+
+        for (unsigned int j = 0; j < active;) {
+            unsigned char *hash = batchHashes + j * HASH_SIZE;
+            bool distinguished = isDistinguished(hash);
+
+            if (!distinguished && ++steps[j] < chainLen) {
+                reduce(hash, DP_COLUMN, pwds[j]);
+                ++j;
+                continue;
+            }
+
+            if (distinguished) {
+                starts[found] = startPwds[j];
+                memcpy(hashes + found * HASH_SIZE, hash, HASH_SIZE);
+                ++found;
+            }
+
+            if (started < n) {
+                // A new chain takes the place of the one which ended.
+                startPassword(firstStart + started, startPwds[j]);
+                pwds[j] = startPwds[j];
+                steps[j] = 0;
+                ++started;
+                ++j;
+            } else {
+                // The last active chain takes its place, its hash yet to be checked.
+                --active;
+                startPwds[j] = startPwds[active];
+                pwds[j] = pwds[active];
+                steps[j] = steps[active];
+                memcpy(hash, batchHashes + active * HASH_SIZE, HASH_SIZE);
+            }
+        }
+    }
+
+    return found;
+}
+
+void RainbowTable::walkToDPs(unsigned char *hashes, unsigned int n, unsigned char *reached) const {
+    Password pwds[CHAIN_BATCH];
+    unsigned char walks[CHAIN_BATCH * HASH_SIZE];
+    unsigned int lanes[CHAIN_BATCH];
+    unsigned int active = 0;
+
+    for (unsigned int j = 0; j < n; ++j) {
+        reached[j] = isDistinguished(hashes + j * HASH_SIZE);
+
+        if (!reached[j]) {
+            lanes[active] = j;
+            memcpy(walks + active * HASH_SIZE, hashes + j * HASH_SIZE, HASH_SIZE);
+            ++active;
+        }
+    }
+
+    // A chain holds at most chainLen hashes, so a hash which is still not
+    // distinguished after chainLen - 1 steps is in none of them.
+    for (long i = 1; i < chainLen && active > 0; ++i) {
+        kernel->reduceBatch(walks, active, DP_COLUMN, pwds);
+        kernel->hashBatch(pwds, active, walks);
+
+        for (unsigned int j = 0; j < active;) {
+            if (!isDistinguished(walks + j * HASH_SIZE)) {
+                ++j;
+                continue;
+            }
+
+            memcpy(hashes + lanes[j] * HASH_SIZE, walks + j * HASH_SIZE, HASH_SIZE);
+            reached[lanes[j]] = 1;
+
+            --active;
+            lanes[j] = lanes[active];
+            memcpy(walks + j * HASH_SIZE, walks + active * HASH_SIZE, HASH_SIZE);
+        }
+    }
+}
 
 void RainbowTable::getEndHash(unsigned char *endHash, unsigned char const *hash, unsigned int k) const {
-    std::string pwd;
     memcpy(endHash, hash, HASH_SIZE);
 
     // Hash and reduce the starting password <columns-starCol> times.
-    for (long i = k; i < chainLen-1; ++i) {
-        pwd = reduce(endHash, i);
-        hashPassword(pwd, endHash);
-    }
+    if (k + 1 < chainLen)
+        kernel->walkHash(endHash, k, chainLen - 1);
 }
 
-bool equal(unsigned char const *hash1, unsigned char const *hash2) {
+bool RainbowTable::getEndHashes(unsigned char *endHashes, unsigned char const *hash, unsigned int k, unsigned int n,
+                                uint64_t *checks, std::atomic<bool> const *cancel) const {
+    Password pwds[LOOKUP_BATCH];
+
+    for (unsigned int j = 0; j < n; ++j)
+        memcpy(endHashes + j * HASH_SIZE, hash, HASH_SIZE);
 
-    for (int i = 0; i < HASH_SIZE; ++i)
-        if (hash1[i] != hash2[i])
+    // The walk from column k + j starts with the hash itself.
+    if (checks) {
+        for (unsigned int j = 0; j < n; ++j)
+            checks[j] = checkpointOf[k + j] >= 0 ? checkBit(hash) << checkpointOf[k + j] : 0;
+    }
+
+    for (long i = k; i < chainLen - 1; ++i) {
+        if (cancel && cancel->load(std::memory_order_relaxed))
             return false;
 
+        // The walk from column k + j only starts at column k + j, so only
+        // the first <i - k + 1> walks are active.
+        unsigned int active = i - k + 1 < n ? i - k + 1 : n;
+
+        kernel->reduceBatch(endHashes, active, i, pwds);
+        kernel->hashBatch(pwds, active, endHashes);
+
+        // The active walks now hold the hash of column i + 1.
+        if (checks && checkpointOf[i + 1] >= 0) {
+            for (unsigned int j = 0; j < active; ++j)
+                checks[j] |= checkBit(endHashes + j * HASH_SIZE) << checkpointOf[i + 1];
+        }
+    }
+
     return true;
 }
 
-std::string RainbowTable::findHashInChain(std::string pwd, unsigned char const *targetHash) const {
-    // int i = 0;
+bool RainbowTable::findHashInChain(Password &pwd, HashTarget const &target, unsigned int column) const {
     unsigned char hash[HASH_SIZE];
 
-    for (long i = 0; i < chainLen; ++i) {
-        hashPassword(pwd, hash);
-        if (equal(hash, targetHash))
-            return pwd;
-        pwd = reduce(hash, i);
-    }
+    // Hash and reduce the password until the column has been reached.
+    kernel->walk(pwd, hash, 0, column);
+
+    // The hash of the password at the column is only compared to the target.
+    return hashMethod->matches(pwd, target);
+}
+
+bool RainbowTable::findHashInChains(std::vector<Candidate> &candidates, HashTarget const &target,
+                                    Password &pwd, std::atomic<bool> const *cancel) const {
+
+    // Deepest candidates first, so that the chains still being regenerated
+    // at any column are always the first ones of the batch.
+    std::sort(candidates.begin(), candidates.end(),
+              [](Candidate const &a, Candidate const &b) { return a.column > b.column; });
+
+    Password pwds[CHAIN_BATCH];
+    unsigned char hashes[CHAIN_BATCH * HASH_SIZE];
+
+    for (size_t first = 0; first < candidates.size(); first += CHAIN_BATCH) {
+        unsigned int n = candidates.size() - first < CHAIN_BATCH ? candidates.size() - first : CHAIN_BATCH;
+        Candidate const *batch = &candidates[first];
 
-    // Hash and reduce the password until the end of the chain has been reached,
-    // or startHash has been found.
+        for (unsigned int j = 0; j < n; ++j)
+            pwds[j] = batch[j].pwd;
 
-    return "";
+        unsigned int active = n;
+
+        for (long i = 0; active > 0; ++i) {
+            if (cancel && cancel->load(std::memory_order_relaxed))
+                return false;
+
+            // Chains whose candidate column is reached are compared to the
+            // target, then dropped.
+            while (active > 0 && batch[active - 1].column == i) {
+                --active;
+                if (hashMethod->matches(pwds[active], target)) {
+                    pwd = pwds[active];
+                    return true;
+                }
+            }
+
+            kernel->hashBatch(pwds, active, hashes);
+            kernel->reduceBatch(hashes, active, i, pwds);
+        }
+    }
+
+    return false;
 }
 
 void RainbowTable::hashPassword(std::string const &pwd, unsigned char *hash) const {
     // Hashes a word using the table's hashing method.
-    this->hashMethod->hash(pwd, hash);
+    this->hashMethod->hash(reinterpret_cast<unsigned char const *>(pwd.c_str()), pwd.size(), hash);
+}
+
+void RainbowTable::digestPassword(std::string const &pwd, unsigned char *digest) const {
+    this->hashMethod->digest(reinterpret_cast<unsigned char const *>(pwd.c_str()), pwd.size(), digest);
+}
+
+void RainbowTable::hashPassword(Password const &pwd, unsigned char *hash) const {
+    this->hashMethod->hash(pwd.data, pwd.len, hash);
+}
+
+bool RainbowTable::crackColumns(HashTarget const &target, unsigned int lo, unsigned int hi, Password &pwd,
+                                std::atomic<bool> const *cancel) const {
+    unsigned char endHashes[LOOKUP_BATCH * HASH_SIZE];
+    uint64_t checks[LOOKUP_BATCH];
+    size_t firstChains[LOOKUP_BATCH];
+    unsigned int nFound[LOOKUP_BATCH];
+    std::vector<Candidate> candidates;
+    Candidate candidate{};
+
+    // Compute the final hashes, when starting at columns lo..hi-1.
+    if (!getEndHashes(endHashes, target.hash, lo, hi - lo, checks, cancel))
+        return false;
+
+    // Look all of them up at once, their searches overlapping.
+    table->findPasswords(endHashes, hi - lo, firstChains, nFound);
+
+    // Gather the start passwords corresponding to every hash (possibly 0, 1 or more),
+    // but the chains whose checkpoints differ.
+    for (unsigned int col = lo; col < hi; ++col) {
+        candidate.column = col;
+        size_t firstChain = firstChains[col - lo];
+
+        for (size_t c = firstChain; c < firstChain + nFound[col - lo]; ++c) {
+            if (!passesChecks(c, col, checks[col - lo]))
+                continue;
+            table->getStart(c, candidate.pwd);
+            candidates.push_back(candidate);
+        }
+    }
+
+    // Regenerate the candidate chains, to find if the hash is contained
+    // in one of them. A single chain is regenerated on its own.
+    if (candidates.size() == 1) {
+        pwd = candidates[0].pwd;
+        return findHashInChain(pwd, target, candidates[0].column);
+    }
+
+    return findHashInChains(candidates, target, pwd, cancel);
+}
+
+bool RainbowTable::crackDP(unsigned char const *targetHash, Password &pwd) const {
+    unsigned char end[HASH_SIZE];
+    unsigned char reached;
+    size_t firstChain;
+    unsigned int nFound;
+
+    memcpy(end, targetHash, HASH_SIZE);
+    walkToDPs(end, 1, &reached);
+
+    if (!reached)
+        return false;
+
+    std::vector<HashTarget> targets(1);
+    std::vector<std::string> results(1);
+    std::vector<Candidate> candidates;
+    Candidate candidate{};
+
+    memcpy(targets[0].hash, targetHash, HASH_SIZE);
+
+    nFound = table->findPassword(end, firstChain);
+
+    for (size_t c = firstChain; c < firstChain + nFound; ++c) {
+        table->getStart(c, candidate.pwd);
+        candidates.push_back(candidate);
+    }
+
+    verifyDPCandidates(candidates, targets, results);
+
+    if (results[0].empty())
+        return false;
+
+    pwd.set(results[0]);
+    return true;
 }
 
 std::string RainbowTable::crackHash(unsigned char const *targetHash) const {
 
     std::string result;
+    Password pwd;
 
-    const int nThreads = omp_get_max_threads();
+    // A single walk to the next distinguished point, and a single probe.
+    if (dpBits > 0)
+        return crackDP(targetHash, pwd) ? pwd.str() : result;
 
-    omp_set_num_threads(nThreads);
+    // Undo what can be undone on the target once, so that false alarms
+    // are rejected early.
+    HashTarget target{};
+    hashMethod->prepareTarget(targetHash, pwdLen, target);
+
+    // Set by the thread which finds the password, so that the others stop.
+    std::atomic<bool> cancelled(false);
 
-    const unsigned int chunkSize = (chainLen + nThreads - 1) / nThreads;
+    // Walking from column k costs chainLen - k steps. Groups of LOOKUP_BATCH
+    // columns are handed out from the last one, cheapest first, to
+    // whichever thread is free.
+    const long nGroups = (chainLen + LOOKUP_BATCH - 1) / LOOKUP_BATCH;
 
-    #pragma omp parallel default(none) shared(result, targetHash, chunkSize) // Parallelize the cracking. Every thread will
-    // try cracking for < columns / nb of threads > different columns.
+    #pragma omp parallel for schedule(dynamic, 1) default(none) firstprivate(pwd) shared(result, target, cancelled, nGroups)
+    for (long g = 0; g < nGroups; ++g) {
+        if (cancelled.load(std::memory_order_relaxed))
+            continue;
+
+        unsigned int hi = chainLen - g * LOOKUP_BATCH;
+        unsigned int lo = hi > LOOKUP_BATCH ? hi - LOOKUP_BATCH : 0;
+
+        // Only the first thread to find the password stores it.
+        if (crackColumns(target, lo, hi, pwd, &cancelled) && !cancelled.exchange(true))
+            result = pwd.str();
+    }
+
+    return result;
+}
+
+void RainbowTable::computeProbes(unsigned char const *hashes, unsigned int const *targets, unsigned int n,
+                                 unsigned int lo, unsigned int hi, std::vector<Probe> &probes) const {
+    const unsigned int width = hi - lo;
+
+    probes.resize((size_t) n * width);
+
+    #pragma omp parallel for schedule(dynamic) default(none) shared(hashes, targets, n, lo, hi, width, probes)
+    for (long t = 0; t < n; ++t) {
+        unsigned char endHashes[LOOKUP_BATCH * HASH_SIZE];
+        uint64_t checks[LOOKUP_BATCH];
+        Probe *row = &probes[t * width];
+
+        for (unsigned int k = lo; k < hi; k += LOOKUP_BATCH) {
+            unsigned int cnt = hi - k < LOOKUP_BATCH ? hi - k : LOOKUP_BATCH;
+
+            getEndHashes(endHashes, hashes + (size_t) targets[t] * HASH_SIZE, k, cnt, checks);
+
+            for (unsigned int j = 0; j < cnt; ++j)
+                row[k - lo + j] = {Endpoint(endHashes + j * HASH_SIZE), checks[j], targets[t], k + j};
+        }
+    }
+}
+
+void RainbowTable::joinProbes(std::vector<Probe> const &probes, std::vector<Candidate> &candidates) const {
+
+    const int nThreads = omp_get_max_threads();
+
+    std::vector<std::vector<Candidate>> found(nThreads);
+
+    // Every thread joins its own range of probes, walking forward from
+    // where its first probe lands.
+    #pragma omp parallel default(none) shared(probes, found, nThreads)
     {
-        int threadNum = omp_get_thread_num(); // Get thread number
+        int threadNum = omp_get_thread_num();
+
+        size_t start = probes.size() * threadNum / nThreads;
+        size_t end = probes.size() * (threadNum + 1) / nThreads;
+
+        Candidate candidate{};
+        size_t from = 0, firstChain;
+        unsigned int nFound;
+
+        for (size_t p = start; p < end; ++p) {
+            nFound = table->findPasswordFrom(probes[p].end, from, firstChain);
+            from = firstChain;
 
-        unsigned int start = threadNum * chunkSize;
-        unsigned int end = start + chunkSize < chainLen ? start + chunkSize : chainLen;
+            candidate.column = probes[p].column;
+            candidate.target = probes[p].target;
 
-        std::string pwd;
-        unsigned char endHash[HASH_SIZE];
-        std::vector<std::string> pwdCandidates;
+            for (size_t c = firstChain; c < firstChain + nFound; ++c) {
+                if (!passesChecks(c, candidate.column, probes[p].checks))
+                    continue;
+                table->getStart(c, candidate.pwd);
+                found[threadNum].push_back(candidate);
+            }
+        }
+    }
+
+    candidates.clear();
+    for (auto const &f : found)
+        candidates.insert(candidates.end(), f.begin(), f.end());
+}
+
+void RainbowTable::verifyCandidates(std::vector<Candidate> &candidates, std::vector<HashTarget> const &targets,
+                                    std::vector<std::string> &results) const {
+
+    // Deepest candidates first, so that every batch holds chains of
+    // similar lengths, and the chains still being regenerated at any
+    // column are the first ones of their batch.
+    std::sort(candidates.begin(), candidates.end(),
+              [](Candidate const &a, Candidate const &b) { return a.column > b.column; });
+
+    std::vector<unsigned char> solved(targets.size());
+
+    for (unsigned int t = 0; t < targets.size(); ++t)
+        solved[t] = !results[t].empty();
+
+    const long nBatches = (candidates.size() + CHAIN_BATCH - 1) / CHAIN_BATCH;
 
-        for (long i = end - 1; i >= start && result.empty(); --i) {
-            // Compute the final hash, when starting at column <col>.
-            getEndHash(endHash, targetHash, i);
+    #pragma omp parallel for schedule(dynamic) default(none) shared(candidates, targets, results, solved, nBatches)
+    for (long b = 0; b < nBatches; ++b) {
+        Password pwds[CHAIN_BATCH];
+        unsigned char hashes[CHAIN_BATCH * HASH_SIZE];
 
-            // Find the start passwords corresponding to the hash (possibly 0, 1 or more).
-            pwdCandidates = table->findPassword(endHash);
+        size_t first = b * CHAIN_BATCH;
+        unsigned int n = candidates.size() - first < CHAIN_BATCH ? candidates.size() - first : CHAIN_BATCH;
+        Candidate const *batch = &candidates[first];
 
-            for (auto &pwdCandidate : pwdCandidates) {
-                // For every start password, try to find if the hash is contained in it.
-                pwd = findHashInChain(pwdCandidate, targetHash);
-                if (!pwd.empty()) {
-                    // If the hash has been found, store the corresponding
-                    // password, causing the loop to stop.
-                    result = pwd;
+        for (unsigned int j = 0; j < n; ++j)
+            pwds[j] = batch[j].pwd;
+
+        unsigned int active = n;
+
+        for (long i = 0; active > 0; ++i) {
+            // Chains whose candidate column is reached are compared to
+            // their target, then dropped.
+            while (active > 0 && batch[active - 1].column == i) {
+                --active;
+
+                unsigned int t = batch[active].target;
+                unsigned char isSolved;
+
+                #pragma omp atomic read
+                isSolved = solved[t];
+
+                if (!isSolved && hashMethod->matches(pwds[active], targets[t])) {
+                    #pragma omp critical(crackHashesResult)
+                    {
+                        if (!solved[t]) {
+                            results[t] = pwds[active].str();
+
+                            #pragma omp atomic write
+                            solved[t] = 1;
+                        }
+                    }
                 }
             }
+
+            kernel->hashBatch(pwds, active, hashes);
+            kernel->reduceBatch(hashes, active, i, pwds);
         }
     }
-    return result;
+}
+
+void RainbowTable::verifyDPCandidates(std::vector<Candidate> const &candidates, std::vector<HashTarget> const &targets,
+                                      std::vector<std::string> &results) const {
+
+    std::vector<unsigned char> solved(targets.size());
+
+    for (unsigned int t = 0; t < targets.size(); ++t)
+        solved[t] = !results[t].empty();
+
+    const long nBatches = (candidates.size() + CHAIN_BATCH - 1) / CHAIN_BATCH;
+
+    #pragma omp parallel for schedule(dynamic) default(none) shared(candidates, targets, results, solved, nBatches)
+    for (long b = 0; b < nBatches; ++b) {
+        Password pwds[CHAIN_BATCH];
+        unsigned char hashes[CHAIN_BATCH * HASH_SIZE];
+        unsigned int lanes[CHAIN_BATCH];
+
+        size_t first = b * CHAIN_BATCH;
+        unsigned int n = candidates.size() - first < CHAIN_BATCH ? candidates.size() - first : CHAIN_BATCH;
+        Candidate const *batch = &candidates[first];
+
+        for (unsigned int j = 0; j < n; ++j) {
+            pwds[j] = batch[j].pwd;
+            lanes[j] = j;
+        }
+
+        unsigned int active = n;
+
+        // The column of the target is unknown: every hash of the chain is
+        // compared to it, until the chain ends at its distinguished point.
+        for (long i = 0; i < chainLen && active > 0; ++i) {
+            kernel->hashBatch(pwds, active, hashes);
+
+            for (unsigned int j = 0; j < active;) {
+                unsigned char *hash = hashes + j * HASH_SIZE;
+                unsigned int t = batch[lanes[j]].target;
+                unsigned char isSolved;
+
+                #pragma omp atomic read
+                isSolved = solved[t];
+
+                bool ended = isSolved || isDistinguished(hash);
+
+                if (!isSolved && memcmp(hash, targets[t].hash, HASH_SIZE) == 0) {
+                    ended = true;
+
+                    #pragma omp critical(crackHashesResult)
+                    {
+                        if (!solved[t]) {
+                            results[t] = pwds[j].str();
+
+                            #pragma omp atomic write
+                            solved[t] = 1;
+                        }
+                    }
+                }
+
+                if (!ended) {
+                    reduce(hash, DP_COLUMN, pwds[j]);
+                    ++j;
+                    continue;
+                }
+
+                // The last active chain takes its place, its hash yet to be checked.
+                --active;
+                pwds[j] = pwds[active];
+                lanes[j] = lanes[active];
+                memcpy(hash, hashes + active * HASH_SIZE, HASH_SIZE);
+            }
+        }
+    }
+}
+
+void RainbowTable::crackDPHashes(unsigned char const *hashes, unsigned int n, std::vector<std::string> &results) const {
+
+    results.assign(n, "");
+
+    std::vector<HashTarget> targets(n);
+    std::vector<Probe> probes(n);
+    std::vector<unsigned char> reached(n);
+
+    for (unsigned int t = 0; t < n; ++t)
+        memcpy(targets[t].hash, hashes + (size_t) t * HASH_SIZE, HASH_SIZE);
+
+    const long nBatches = (n + CHAIN_BATCH - 1) / CHAIN_BATCH;
+
+    // Walk every target to its distinguished point, CHAIN_BATCH at once.
+    #pragma omp parallel for schedule(dynamic) default(none) shared(hashes, n, probes, reached, nBatches)
+    for (long b = 0; b < nBatches; ++b) {
+        unsigned char walks[CHAIN_BATCH * HASH_SIZE];
+        unsigned int first = b * CHAIN_BATCH;
+        unsigned int cnt = n - first < CHAIN_BATCH ? n - first : CHAIN_BATCH;
+
+        memcpy(walks, hashes + (size_t) first * HASH_SIZE, cnt * HASH_SIZE);
+        walkToDPs(walks, cnt, &reached[first]);
+
+        for (unsigned int j = 0; j < cnt; ++j)
+            probes[first + j] = {Endpoint(walks + j * HASH_SIZE), 0, first + j, 0};
+    }
+
+    // The targets which reached no distinguished point are in no chain.
+    unsigned int m = 0;
+    for (unsigned int t = 0; t < n; ++t) {
+        if (reached[t])
+            probes[m++] = probes[t];
+    }
+    probes.resize(m);
+
+    std::sort(probes.begin(), probes.end(),
+              [](Probe const &a, Probe const &b) { return a.end < b.end; });
+
+    std::vector<Candidate> candidates;
+    joinProbes(probes, candidates);
+
+    verifyDPCandidates(candidates, targets, results);
+}
+
+void RainbowTable::crackBand(unsigned char const *hashes, std::vector<unsigned int> const &unsolved,
+                             std::vector<HashTarget> const &targets, unsigned int lo, unsigned int hi,
+                             std::vector<std::string> &results) const {
+    std::vector<Probe> probes;
+    std::vector<Candidate> candidates;
+
+    // The end hashes of all the targets may not fit in memory at once.
+    const unsigned int width = hi - lo;
+    const unsigned int batchTargets = width < CRACK_BATCH_PROBES ? CRACK_BATCH_PROBES / width : 1;
+
+    for (unsigned int first = 0; first < unsolved.size(); first += batchTargets) {
+        unsigned int m = unsolved.size() - first < batchTargets ? unsolved.size() - first : batchTargets;
+
+        computeProbes(hashes, &unsolved[first], m, lo, hi, probes);
+
+        std::sort(probes.begin(), probes.end(),
+                  [](Probe const &a, Probe const &b) { return a.end < b.end; });
+
+        joinProbes(probes, candidates);
+
+        verifyCandidates(candidates, targets, results);
+    }
+}
+
+void RainbowTable::crackHashes(unsigned char const *hashes, unsigned int n, std::vector<std::string> &results) const {
+
+    if (dpBits > 0) {
+        crackDPHashes(hashes, n, results);
+        return;
+    }
+
+    results.assign(n, "");
+
+    std::vector<HashTarget> targets(n);
+    std::vector<unsigned int> unsolved(n);
+
+    for (unsigned int t = 0; t < n; ++t) {
+        hashMethod->prepareTarget(hashes + (size_t) t * HASH_SIZE, pwdLen, targets[t]);
+        unsolved[t] = t;
+    }
+
+    // Bands of columns from the last one, twice as wide every time: the
+    // cheap columns find most of the passwords, in a few passes over the table.
+    unsigned int width = LOOKUP_BATCH;
+
+    for (unsigned int hi = chainLen; hi > 0 && !unsolved.empty(); hi -= width, width *= 2) {
+        width = hi < width ? hi : width;
+
+        crackBand(hashes, unsolved, targets, hi - width, hi, results);
+
+        unsolved.erase(std::remove_if(unsolved.begin(), unsolved.end(),
+                                      [&results](unsigned int t) { return !results[t].empty(); }),
+                       unsolved.end());
+    }
 }
 
 std::string RainbowTable::crackPassword(std::string const &password) const {
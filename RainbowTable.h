@@ -5,46 +5,237 @@
 #ifndef RAINBOWHACKING_RAINBOWTABLE_H
 #define RAINBOWHACKING_RAINBOWTABLE_H
 
+#include <atomic>
 #include <vector>
 #include <string>
 #include "HashMethod.hpp"
 #include "TableBuilder.hpp"
+#include "TableFile.h"
+#include "ExternalTableBuilder.h"
+#include "ChainKernel.h"
+#include "Reduction.hpp"
+#include "Keyspace.hpp"
 
-#define LETTERSLOWER "abcdefghijklmnopqrstuvwxyz"
-#define LETTERSUPPER "ABCDEFGHIJKLMNOPQRSTUVWXYZ"
-#define DIGITS "0123456789"
+#define CHAIN_BATCH 64  /* Number of chains generated in lockstep by each thread */
+#define LOOKUP_BATCH 64 /* Number of columns whose end hashes are computed in lockstep */
+#define CRACK_BATCH_PROBES (1u << 22)   /* End hashes sorted and joined with the table at once */
+#define DP_CHAIN_BLOCK 1024 /* Distinguished point chains started by a thread at once */
+#define DP_COLUMN 0         /* Column whose reduction every step of a distinguished point chain uses */
+
+/**
+ * Build options of a new table, on top of its main parameters.
+ */
+struct TableOptions {
+    /* Columns at which a bit of the hash of every chain is kept, to reject false alarms */
+    std::vector<unsigned int> checkpoints;
+
+    /* Whether to keep a single chain per end hash, generating chains until there are enough */
+    bool perfect = false;
+
+    /* Zero bits ending a chain at a distinguished point, 0 for a rainbow table of fixed length chains */
+    unsigned int dpBits = 0;
+
+    /* Index of the table in a set of tables, mixed into the reduction */
+    unsigned int tableIndex = 0;
+
+    /* Reduction function, REDUCE_BYTES or REDUCE_INDEX. REDUCE_KEYSPACE with a mask or a length range */
+    unsigned int reduction = REDUCE_BYTES;
+
+    /* Charset of every position, as "?u?l?l?d", "" for the domain at every position */
+    std::string mask;
+
+    /* Length of the shortest passwords, 0 for passwords of a single length */
+    unsigned int minLen = 0;
+
+    /* Bits per chain of the filter rejecting end hashes not in the table, 0 for no filter */
+    unsigned int filterBits = 0;
+
+    /* Whether to look end hashes up through a bucket directory, rather than by binary search */
+    bool directory = false;
+
+    /* Index in the keyspace of the start password of chain 0 */
+    uint64_t seed = 0;
+
+    /* Index of the first chain, so that a table can be generated by ranges of chains */
+    uint64_t firstStart = 0;
+
+    /* Memory a table built straight into a file stays within, in bytes */
+    size_t memoryBudget = EXTERNAL_DEFAULT_BUDGET;
+};
 
 class RainbowTable {
 
 private:
+    /* Start password of a chain which may contain the target hash at <column>. */
+    struct Candidate {
+        Password pwd;
+        unsigned int column;
+        unsigned int target;    /* Index of the target hash, when cracking several hashes */
+    };
+
+    /* End hash of a target hash walked from <column>. */
+    struct Probe {
+        Endpoint end;
+        uint64_t checks;    /* Checkpoint bits met on the way */
+        unsigned int target;
+        unsigned int column;
+    };
+
     unsigned int chainLen{};  /* Length each chain */
     // unsigned int nChains;
     std::string domain;           /* Array of characters to check for. */
-    unsigned int pwdLen{};    /* Size of the passwords */
+    unsigned int pwdLen{};    /* Size of the passwords, the longest ones with a length range */
+    unsigned int minLen{};    /* Size of the shortest passwords */
+    std::string mask;         /* Charset of every position, "" for the domain at every position */
     Table *table{};            /* Table containing all the rows (hash + password) */
     HashMethod *hashMethod{}; /* Hashing function */
+    ChainKernel *kernel{};    /* Chain walk specialized on the hashing method, pwdLen and domain */
+    unsigned int dpBits{};    /* Zero bits of a distinguished point, 0 for a rainbow table */
+    unsigned int tableIndex{};    /* Index of the table in a set of tables */
+    unsigned int reduction{};     /* Reduction function, REDUCE_BYTES or REDUCE_INDEX */
+    unsigned int filterBits{};    /* Bits per chain of the end hash filter, 0 for none */
+    bool directory{};             /* Whether the end hashes have a bucket directory */
+    Keyspace keyspace{std::string(), 0};    /* Passwords of <minLen> to <pwdLen> characters of the domain or mask */
+    uint64_t seed{};              /* Index in the keyspace of the start password of chain 0 */
+    uint64_t nextStart{};         /* Index of the next chain started, counting the dropped ones */
+
+    bool perfect{};                         /* Whether all the end hashes are distinct */
+    std::vector<unsigned int> checkpoints;  /* Columns of the checkpoints, increasing */
+    std::vector<int> checkpointOf;          /* Checkpoint at every column, -1 if none */
+    std::vector<uint64_t> knownChecks;      /* Checkpoints met when walking from every column */
+
+    /**
+     * Builds the keyspace of the domain, mask and lengths of the table, and
+     * picks the keyspace reduction if the passwords are not all of pwdLen
+     * characters of the domain.
+     */
+    void initKeyspace();
+
+    /**
+     * Picks the chain kernel of the parameters of the table.
+     */
+    void initKernel();
+
+    /**
+     * Validates the checkpoint columns, and indexes them by column.
+     */
+    void initCheckpoints();
+
+    /**
+     * @return the checkpoint bit of a hash.
+     */
+    static inline uint64_t checkBit(unsigned char const *hash) {
+        return hash[0] & 1u;
+    }
+
+    /**
+     * @return true if a hash is a distinguished point: its top <dpBits> bits are zero.
+     */
+    inline bool isDistinguished(unsigned char const *hash) const {
+        uint64_t top = 0;
+        for (int i = 0; i < 8; ++i)
+            top = (top << 8u) | hash[i];
+        return (top >> (64 - dpBits)) == 0;
+    }
 
     /**
      * Initialize table.
      */
     void initTable(unsigned int nChains);
 
+    /**
+     * Derives the start password of a chain from its index, so that start
+     * passwords are distinct as long as there are fewer chains than
+     * passwords, and any range of chains can be generated on its own.
+     * @param index: The index of the chain, counting every chain started.
+     * @param pwd: Placeholder for the password.
+     */
+    void startPassword(uint64_t index, Password &pwd) const;
+
+    /**
+     * Generates chains into a new table or an existing one. A perfect table
+     * gets chains until it has <nChains> more distinct end hashes.
+     * @param nChains: Number of chains to add.
+     * @param rainbowTable: Table to extend, or nullptr for a new table.
+     */
     void generateChains(unsigned int nChains, Table *rainbowTable = nullptr);
 
     /**
-     *
-     * @param hash
-     * @param column
-     * @return
+     * Generates chains from the next start indices, and builds the table.
+     * @param nChains: Number of chains to generate.
+     * @param rainbowTable: Table to extend, or nullptr for a new table.
+     * @param indexed: Whether to add the filter and directory of the options, false for a run of an out-of-core build.
+     * @return The table built.
+     */
+    Table *appendChains(unsigned int nChains, Table *rainbowTable, bool indexed = true);
+
+    /**
+     * Generates distinguished point chains from the next start indices, until
+     * <nChains> of them reach a distinguished point, and builds the table.
+     * Chains longer than chainLen are dropped.
+     * @param nChains: Number of chains to keep.
+     * @param rainbowTable: Table to extend, or nullptr for a new table.
+     * @param indexed: Whether to add the filter and directory of the options.
+     * @return The table built.
+     */
+    Table *appendDPChains(unsigned int nChains, Table *rainbowTable, bool indexed = true);
+
+    /**
+     * Takes the parameters of a table read from a file.
+     * @param header: The parameters read from the file.
+     */
+    void setParameters(TableFileHeader const &header);
+
+    /**
+     * Fills the parameters of the table, to write it to a file.
+     * @param header: Placeholder for the parameters.
+     */
+    void getParameters(TableFileHeader &header) const;
+
+    /**
+     * Reduces a hash into a password.
+     * @param hash: The hash to reduce.
+     * @param column: The column of the hash in its chain.
+     * @param pwd: Placeholder for the password.
      */
-    std::string reduce(unsigned char const *hash, unsigned int column) const;
+    void reduce(unsigned char const *hash, unsigned int column, Password &pwd) const;
 
     /**
      *
-     * @param pwd
-     * @param hash
+     * @param pwd: The start password.
+     * @param hash: Placeholder for the end hash.
      */
-    void createChain(std::string pwd, unsigned char *hash) const;
+    void createChain(Password pwd, unsigned char *hash) const;
+
+    /**
+     * Creates several chains in lockstep, so that the hashing method can
+     * process all of them at once at every column.
+     * @param pwds: The <n> start passwords. Overwritten.
+     * @param n: Number of chains.
+     * @param hashes: Placeholder for the n end hashes.
+     * @param checks: Placeholder for the checkpoint bits of the n chains, or nullptr.
+     */
+    void createChains(Password *pwds, unsigned int n, unsigned char *hashes, uint64_t *checks = nullptr) const;
+
+    /**
+     * Generates distinguished point chains from consecutive start indices.
+     * CHAIN_BATCH chains advance in lockstep, and a chain which ends is
+     * replaced by a new one right away, so that every batch stays full.
+     * @param n: Number of chains to start.
+     * @param firstStart: Start index of the first chain.
+     * @param starts: Placeholder for the start passwords of the chains kept.
+     * @param hashes: Placeholder for their distinguished points.
+     * @return The number of chains which reached a distinguished point within chainLen hashes.
+     */
+    unsigned int createDPChains(unsigned int n, uint64_t firstStart, Password *starts, unsigned char *hashes) const;
+
+    /**
+     * Walks several hashes forward in lockstep, each one until a distinguished point.
+     * @param hashes: The <n> hashes, replaced by the distinguished points reached.
+     * @param n: Number of hashes, at most CHAIN_BATCH.
+     * @param reached: Placeholder for n flags, 0 for the hashes that no chain can contain.
+     */
+    void walkToDPs(unsigned char *hashes, unsigned int n, unsigned char *reached) const;
 
     /**
      *
@@ -53,13 +244,136 @@ private:
      */
     void getEndHash(unsigned char *endHash, unsigned char const *hash, unsigned int k) const;
 
+    /**
+     * Computes the end hashes for <n> consecutive columns at once.
+     * The walks from the different columns advance in lockstep, so that
+     * the hashing method can process them together.
+     * @param endHashes: Placeholder for the n end hashes, the one of column k first.
+     * @param hash: The hash to walk from.
+     * @param k: The first column.
+     * @param n: Number of columns, at most LOOKUP_BATCH.
+     * @param checks: Placeholder for the checkpoint bits met by the n walks, or nullptr.
+     * @param cancel: Flag telling to stop as soon as possible, or nullptr.
+     * @return false if cancelled.
+     */
+    bool getEndHashes(unsigned char *endHashes, unsigned char const *hash, unsigned int k, unsigned int n,
+                      uint64_t *checks = nullptr, std::atomic<bool> const *cancel = nullptr) const;
+
+    /**
+     * Checks whether a chain may contain a hash at a column, from its checkpoints.
+     * @param chain: Index of the chain in the table.
+     * @param column: Column of the hash.
+     * @param checks: Checkpoint bits met when walking from the hash to the end.
+     * @return false if the chain cannot contain the hash: a false alarm.
+     */
+    bool passesChecks(size_t chain, unsigned int column, uint64_t checks) const {
+        uint64_t known = knownChecks[column];
+        return known == 0 || ((table->getChecks(chain) ^ checks) & known) == 0;
+    }
+
     /**
      * Finds a hash in a chain.
-     * @param startPwd: Start password of the chain.
-     * @param startHash: Hash to find.
-     * @return The password associated to the hash if it is found, "" otherwise.
+     * @param pwd: Start password of the chain. Replaced by the password at the column.
+     * @param target: Hash to find, prepared by the hashing method.
+     * @param column: Column of the chain where the hash may be.
+     * @return true if the hash is found, false otherwise.
+     */
+    bool findHashInChain(Password &pwd, HashTarget const &target, unsigned int column) const;
+
+    /**
+     * Regenerates several candidate chains in lockstep, each one up to the
+     * column where it may contain the target hash.
+     * @param candidates: The candidate chains.
+     * @param target: Hash to find, prepared by the hashing method.
+     * @param pwd: Placeholder for the password associated to the hash.
+     * @param cancel: Flag telling to stop as soon as possible, or nullptr.
+     * @return true if the hash is found, false otherwise or if cancelled.
+     */
+    bool findHashInChains(std::vector<Candidate> &candidates, HashTarget const &target, Password &pwd,
+                          std::atomic<bool> const *cancel = nullptr) const;
+
+    /**
+     * Computes the end hashes of some target hashes, for a band of columns.
+     * @param hashes: All the target hashes.
+     * @param targets: Indices of the <n> target hashes to walk.
+     * @param n: Number of target hashes to walk.
+     * @param lo: First column of the band.
+     * @param hi: End of the band.
+     * @param probes: Placeholder for the n * (hi - lo) end hashes.
+     */
+    void computeProbes(unsigned char const *hashes, unsigned int const *targets, unsigned int n,
+                       unsigned int lo, unsigned int hi, std::vector<Probe> &probes) const;
+
+    /**
+     * Joins sorted end hashes with the table, walking the table once.
+     * @param probes: The end hashes, sorted.
+     * @param candidates: Placeholder for the chains matching them.
+     */
+    void joinProbes(std::vector<Probe> const &probes, std::vector<Candidate> &candidates) const;
+
+    /**
+     * Regenerates the candidate chains of several target hashes in lockstep,
+     * each one up to the column where it may contain its target.
+     * @param candidates: The candidate chains.
+     * @param targets: All the target hashes, prepared by the hashing method.
+     * @param results: The passwords found so far, "" for the others.
      */
-    std::string findHashInChain(std::string pwd, unsigned char const *targetHash) const;
+    void verifyCandidates(std::vector<Candidate> &candidates, std::vector<HashTarget> const &targets,
+                          std::vector<std::string> &results) const;
+
+    /**
+     * Regenerates distinguished point chains in lockstep, each one until it
+     * meets its target hash or ends.
+     * @param candidates: The candidate chains.
+     * @param targets: All the target hashes.
+     * @param results: The passwords found so far, "" for the others.
+     */
+    void verifyDPCandidates(std::vector<Candidate> const &candidates, std::vector<HashTarget> const &targets,
+                            std::vector<std::string> &results) const;
+
+    /**
+     * Cracks hashes with a distinguished point table: every hash is walked
+     * to the next distinguished point, which is looked up once.
+     * @param hashes: The <n> hashes to crack, one after another.
+     * @param n: Number of hashes.
+     * @param results: Placeholder for the n passwords, "" for the ones not found.
+     */
+    void crackDPHashes(unsigned char const *hashes, unsigned int n, std::vector<std::string> &results) const;
+
+    /**
+     * Looks a hash up from a group of columns: computes their end hashes,
+     * then regenerates the chains matching them.
+     * @param target: Hash to find, prepared by the hashing method.
+     * @param lo: First column of the group.
+     * @param hi: End of the group, at most LOOKUP_BATCH columns after lo.
+     * @param pwd: Placeholder for the password found.
+     * @param cancel: Flag telling to stop as soon as possible, or nullptr.
+     * @return true if the password is found.
+     */
+    bool crackColumns(HashTarget const &target, unsigned int lo, unsigned int hi, Password &pwd,
+                      std::atomic<bool> const *cancel = nullptr) const;
+
+    /**
+     * Looks a hash up in a distinguished point table.
+     * @param targetHash: Hash to find.
+     * @param pwd: Placeholder for the password found.
+     * @return true if the password is found.
+     */
+    bool crackDP(unsigned char const *targetHash, Password &pwd) const;
+
+    /**
+     * Looks several hashes up from a band of columns, joining their end
+     * hashes with the table in sorted batches.
+     * @param hashes: All the target hashes.
+     * @param unsolved: Indices of the target hashes to look up.
+     * @param targets: All the target hashes, prepared by the hashing method.
+     * @param lo: First column of the band.
+     * @param hi: End of the band.
+     * @param results: The passwords found so far, "" for the others.
+     */
+    void crackBand(unsigned char const *hashes, std::vector<unsigned int> const &unsolved,
+                   std::vector<HashTarget> const &targets, unsigned int lo, unsigned int hi,
+                   std::vector<std::string> &results) const;
 
 public:
     /**
@@ -75,9 +389,11 @@ public:
       * @param domain: All the available characters
       * @param pwdLen: The length of password
       * @param hashMethod: The hashing method
+      * @param options: The build options
       */
     RainbowTable(unsigned int chainLen, unsigned int nChains,
-                 std::string const &domain, unsigned int pwdLen, HashMethod* hashMethod);
+                 std::string const &domain, unsigned int pwdLen, HashMethod* hashMethod,
+                 TableOptions const &options = TableOptions());
 
     /**
      * Destructor
@@ -87,18 +403,45 @@ public:
     void extendTable(unsigned int nChains);
 
     /**
-      * Generates and returns a new correct password.
+     * Generates chains straight into a binary table file, a run at a time,
+     * so that the table can be much larger than the memory. Runs are sorted,
+     * spilled to disk, then merged, keeping a single chain per end hash if
+     * the table is perfect. A perfect table gets more runs until it holds
+     * <nChains> distinct end hashes, or saturates. The current table is left as it is.
+     * @param filePath: The path of the table file, ending with TABLE_FILE_EXTENSION.
+     * @param nChains: Number of chains to generate, or of distinct end hashes if perfect.
+     * @param memoryBudget: Memory to stay within, in bytes.
+     * @return The number of chains written, or -1 on error.
+     */
+    long buildFile(std::string const &filePath, uint64_t nChains, size_t memoryBudget);
+
+    /**
+     * Stores the table as a compact index, trading some false alarms for memory.
+     * @param suffixBits: Bits of every end hash to keep, besides the ones implied by its bucket.
+     */
+    void compactTable(unsigned int suffixBits);
+
+    /**
+      * Generates and returns a new correct password, at random.
       */
     std::string randomPassword() const;
 
     /**
-     * Initialize a table from a file.
+     * Initialize a table from a file, either a binary table file or a text file.
      * @param fileName: The path of the file to read from.
      */
     void initFromFile(std::string const &filePath);
 
     /**
-     * Write the table to a file.
+     * @return true if a table has been generated or loaded.
+     */
+    bool isLoaded() const {
+        return table != nullptr;
+    }
+
+    /**
+     * Write the table to a file: a binary table file if the path ends
+     * with TABLE_FILE_EXTENSION, a text file otherwise.
      * @param filePath: The path of the file to write to.
      */
     void writeToFile(std::string const &filePath) const;
@@ -110,6 +453,27 @@ public:
      */
     void hashPassword(std::string const &pwd, unsigned char *hash) const;
 
+    /**
+     * Computes the whole digest of a password.
+     * @param pwd: The password.
+     * @param digest: Placeholder for the digestSize() bytes of the digest.
+     */
+    void digestPassword(std::string const &pwd, unsigned char *digest) const;
+
+    /**
+     * @return the size of the digests of the hashing method, in bytes.
+     */
+    unsigned int digestSize() const {
+        return hashMethod->digestSize();
+    }
+
+    /**
+     *
+     * @param pwd
+     * @param hash
+     */
+    void hashPassword(Password const &pwd, unsigned char *hash) const;
+
     /**
      *
      * @param startHash: Hash to crack.
@@ -117,12 +481,27 @@ public:
      */
     std::string crackHash(unsigned char const *targetHash) const;
 
+    /**
+     * Cracks many hashes at once. The end hashes of all of them are sorted
+     * and joined with the table in a single forward pass, then the
+     * candidate chains are regenerated together.
+     * Columns are processed in bands, cheapest first, so that the hashes
+     * found early are not walked any further.
+     * @param hashes: The <n> hashes to crack, one after another.
+     * @param n: Number of hashes.
+     * @param results: Placeholder for the n passwords, "" for the ones not found.
+     */
+    void crackHashes(unsigned char const *hashes, unsigned int n, std::vector<std::string> &results) const;
+
     /**
      * Hashes a password and tries to crack it.
      * @param word: Password to hash, and then to crack.
      * @return: Word if the password is found, "" otherwise.
      */
     std::string crackPassword(std::string const &password) const;
+
+    friend class Benchmark;
+    friend class TableSet;
 };
 
 #endif //RAINBOWHACKING_RAINBOWTABLE_H
@@ -0,0 +1,172 @@
+#ifndef RAINBOWHACKING_REDUCTION_HPP
+#define RAINBOWHACKING_REDUCTION_HPP
+
+#include <cstdint>
+#include <string>
+#include "HashMethod.hpp"
+#include "Keyspace.hpp"
+#include "Password.hpp"
+
+#define REDUCE_BYTES 0      /* Every character from a byte of the hash plus the column */
+#define REDUCE_INDEX 1      /* The password from the whole hash, read as an index in the keyspace */
+#define REDUCE_KEYSPACE 2   /* The index of the password in a keyspace of masks and lengths, from the whole hash */
+#define REDUCE_COUNT 3
+
+/**
+ * Reduction functions, from a hash at a column back to a password.
+ *
+ * Templated on the password length and the size of the domain, which are
+ * read from the template parameters when they are not 0, so that the chain
+ * kernels get them as constants.
+ */
+class Reduction {
+
+private:
+    /**
+     * Finalizer of SplitMix64, spreading consecutive columns over 64 bits.
+     */
+    static inline uint64_t mix(uint64_t z) {
+        z = (z ^ (z >> 30u)) * 0xbf58476d1ce4e5b9u;
+        z = (z ^ (z >> 27u)) * 0x94d049bb133111ebu;
+        return z ^ (z >> 31u);
+    }
+
+public:
+    /**
+     * @return the name of a reduction function.
+     */
+    static char const *name(unsigned int reduction) {
+        switch (reduction) {
+            case REDUCE_INDEX: return "index";
+            case REDUCE_KEYSPACE: return "keyspace";
+            default: return "bytes";
+        }
+    }
+
+    /**
+     * Parses the name of a reduction function.
+     * @param reduction: Placeholder for the reduction function.
+     * @return false if there is no reduction function of that name.
+     */
+    static bool parse(std::string const &name, unsigned int &reduction) {
+        for (unsigned int r = 0; r < REDUCE_COUNT; ++r) {
+            if (name == Reduction::name(r)) {
+                reduction = r;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    /**
+     * Reduces a hash byte by byte: every character is picked by one byte of
+     * the hash plus the column, modulo the size of the domain. Only pwdLen
+     * bytes of the hash are read, and domains whose size is not a power of
+     * two favour their first characters.
+     * @param hash: The hash to reduce, of HASH_SIZE bytes.
+     * @param column: The column of the hash in its chain.
+     * @param offset: Column offset of the table in its set, tableIndex * chainLen.
+     * @param salt: Byte xored with the hash, the index of the table in its set.
+     * @param pwd: Placeholder for the password.
+     */
+    template <unsigned int PwdLen, unsigned int DomainSize>
+    static inline void bytes(unsigned char const *hash, unsigned int column, uint64_t offset, unsigned char salt,
+                             char const *domain, unsigned int pwdLen, unsigned int domainSize, Password &pwd) {
+        const unsigned int len = PwdLen > 0 ? PwdLen : pwdLen;
+        const unsigned int size = DomainSize > 0 ? DomainSize : domainSize;
+        const unsigned int k = column + (unsigned int) offset;
+
+        pwd.len = len;
+
+        #pragma GCC unroll 56
+        for (unsigned int i = 0; i < len; ++i) {
+            // The value column is added so as to same inputs at different
+            // columns will generate a different reduced password.
+            unsigned int index = (hash[(i + k) % HASH_SIZE] ^ salt) + k;
+            pwd.data[i] = domain[index % size];
+        }
+    }
+
+    /**
+     * Reduces a hash as an index in the keyspace: both halves of the hash,
+     * xored with a mix of the column, are read as fractions of 1, whose
+     * digits in the base of the domain are the characters of the first and
+     * second half of the password. Each digit is the high word of a 64 x 64
+     * bits product, so that every character is uniform to within 2^-64
+     * whatever the size of the domain, and the whole hash is used.
+     * @param hash: The hash to reduce, of HASH_SIZE bytes.
+     * @param column: The column of the hash in its chain.
+     * @param offset: Column offset of the table in its set, tableIndex * chainLen.
+     * @param pwd: Placeholder for the password.
+     */
+    template <unsigned int PwdLen, unsigned int DomainSize>
+    static inline void index(unsigned char const *hash, unsigned int column, uint64_t offset,
+                             char const *domain, unsigned int pwdLen, unsigned int domainSize, Password &pwd) {
+        const unsigned int len = PwdLen > 0 ? PwdLen : pwdLen;
+        const unsigned int size = DomainSize > 0 ? DomainSize : domainSize;
+        const uint64_t c = mix((column + offset + 1) * 0x9e3779b97f4a7c15u);
+
+        uint64_t hi = 0, lo = 0;
+        for (int i = 0; i < 8; ++i) {
+            hi = (hi << 8u) | hash[i];
+            lo = (lo << 8u) | hash[i + 8];
+        }
+
+        uint64_t x = hi ^ c;
+        const unsigned int half = (len + 1) / 2;
+
+        pwd.len = len;
+
+        #pragma GCC unroll 56
+        for (unsigned int i = 0; i < len; ++i) {
+            if (i == half)
+                x = lo ^ c;
+
+            unsigned __int128 digit = (unsigned __int128) x * size;
+            pwd.data[i] = domain[(unsigned int) (digit >> 64u)];
+            x = (uint64_t) digit;
+        }
+    }
+
+    /**
+     * Reduces a hash into a keyspace of any charsets and lengths: both
+     * halves of the hash, xored together and with a mix of the column, are
+     * read as a fraction of 1, whose product with the size of the keyspace
+     * is the index of the password.
+     * @param hash: The hash to reduce, of HASH_SIZE bytes.
+     * @param column: The column of the hash in its chain.
+     * @param offset: Column offset of the table in its set, tableIndex * chainLen.
+     * @param keyspace: The passwords, at most 2^64 of them.
+     * @param pwd: Placeholder for the password.
+     */
+    static inline void keyspace(unsigned char const *hash, unsigned int column, uint64_t offset,
+                                Keyspace const &keyspace, Password &pwd) {
+        uint64_t hi = 0, lo = 0;
+        for (int i = 0; i < 8; ++i) {
+            hi = (hi << 8u) | hash[i];
+            lo = (lo << 8u) | hash[i + 8];
+        }
+
+        const uint64_t x = hi ^ lo ^ mix((column + offset + 1) * 0x9e3779b97f4a7c15u);
+
+        // A keyspace too large for 64 bits, of a single length, takes the 64 bits as they are.
+        const uint64_t size = keyspace.size();
+        keyspace.unrank(size > 0 ? (uint64_t) (((unsigned __int128) x * size) >> 64u) : x, pwd);
+    }
+
+    /**
+     * Reduces a hash with one of the reduction functions of a domain.
+     */
+    template <unsigned int PwdLen, unsigned int DomainSize>
+    static inline void reduce(unsigned int reduction, unsigned char const *hash, unsigned int column,
+                              uint64_t offset, unsigned char salt, char const *domain, unsigned int pwdLen,
+                              unsigned int domainSize, Password &pwd) {
+        if (reduction == REDUCE_INDEX)
+            index<PwdLen, DomainSize>(hash, column, offset, domain, pwdLen, domainSize, pwd);
+        else
+            bytes<PwdLen, DomainSize>(hash, column, offset, salt, domain, pwdLen, domainSize, pwd);
+    }
+};
+
+#endif //RAINBOWHACKING_REDUCTION_HPP
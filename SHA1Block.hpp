@@ -0,0 +1,106 @@
+#ifndef RAINBOWHACKING_SHA1BLOCK_HPP
+#define RAINBOWHACKING_SHA1BLOCK_HPP
+
+#include <cstdint>
+
+/* Initial state */
+const uint32_t SHA1_IV[5] = {0x67452301u, 0xefcdab89u, 0x98badcfeu, 0x10325476u, 0xc3d2e1f0u};
+
+/* Additive constant of every round */
+const uint32_t SHA1_K[4] = {0x5a827999u, 0x6ed9eba1u, 0x8f1bbcdcu, 0xca62c1d6u};
+
+/**
+ * SHA-1 of messages which fit in a single block.
+ * The 80 rounds run on a rolling window of 16 message schedule words.
+ */
+class SHA1Block {
+
+private:
+    static inline uint32_t rotl(uint32_t x, unsigned int s) {
+        return (x << s) | (x >> (32u - s));
+    }
+
+    /**
+     * Round function of round i.
+     */
+    static inline uint32_t round(unsigned int i, uint32_t b, uint32_t c, uint32_t d) {
+        switch (i / 20) {
+            case 0: return d ^ (b & (c ^ d));
+            case 2: return (b & c) | (d & (b | c));
+            default: return b ^ c ^ d;
+        }
+    }
+
+    /**
+     * Runs the 80 rounds on a block, then writes the first <size> bytes of the digest.
+     * @param w: The message words, overwritten by the message schedule.
+     */
+    static inline void compress(uint32_t *w, unsigned char *digest, unsigned int size) {
+        uint32_t a = SHA1_IV[0], b = SHA1_IV[1], c = SHA1_IV[2], d = SHA1_IV[3], e = SHA1_IV[4];
+
+        #pragma GCC unroll 80
+        for (unsigned int i = 0; i < 80; ++i) {
+            if (i >= 16)
+                w[i & 15u] = rotl(w[(i - 3) & 15u] ^ w[(i - 8) & 15u] ^ w[(i - 14) & 15u] ^ w[i & 15u], 1);
+
+            uint32_t t = rotl(a, 5) + round(i, b, c, d) + e + SHA1_K[i / 20] + w[i & 15u];
+            e = d;
+            d = c;
+            c = rotl(b, 30);
+            b = a;
+            a = t;
+        }
+
+        uint32_t const x[5] = {a, b, c, d, e};
+
+        for (unsigned int i = 0; i < size; ++i)
+            digest[i] = (unsigned char) ((x[i >> 2u] + SHA1_IV[i >> 2u]) >> (24 - ((i & 3u) << 3u)));
+    }
+
+public:
+    /* Longest message that fits in a single block */
+    static const unsigned int MAX_LEN = 55;
+
+    /* Size of a whole digest */
+    static const unsigned int DIGEST_SIZE = 20;
+
+    /**
+     * Hashes a message.
+     * @param msg: The message.
+     * @param len: The length of the message, at most MAX_LEN.
+     * @param digest: Placeholder for the first <size> bytes of the digest.
+     * @param size: Bytes of the digest to write, at most DIGEST_SIZE.
+     */
+    static inline void hash(unsigned char const *msg, unsigned int len, unsigned char *digest, unsigned int size) {
+        uint32_t w[16] = {};
+
+        for (unsigned int i = 0; i < len; ++i)
+            w[i >> 2u] |= (uint32_t) msg[i] << (24 - ((i & 3u) << 3u));
+        w[len >> 2u] |= 0x80u << (24 - ((len & 3u) << 3u));
+        w[15] = len << 3u;
+
+        compress(w, digest, size);
+    }
+
+    /**
+     * Hashes a message whose length is known at compile time, so that its
+     * words are loaded with constant shifts, unrolled.
+     * @tparam Len: The length of the message, at most MAX_LEN.
+     */
+    template <unsigned int Len>
+    static inline void hashFixed(unsigned char const *msg, unsigned char *digest, unsigned int size) {
+        static_assert(Len <= MAX_LEN, "The message must fit in a single block.");
+
+        uint32_t w[16] = {};
+
+        #pragma GCC unroll 56
+        for (unsigned int i = 0; i < Len; ++i)
+            w[i >> 2u] |= (uint32_t) msg[i] << (24 - ((i & 3u) << 3u));
+        w[Len >> 2u] |= 0x80u << (24 - ((Len & 3u) << 3u));
+        w[15] = Len << 3u;
+
+        compress(w, digest, size);
+    }
+};
+
+#endif //RAINBOWHACKING_SHA1BLOCK_HPP
@@ -0,0 +1,115 @@
+#ifndef RAINBOWHACKING_SHA256BLOCK_HPP
+#define RAINBOWHACKING_SHA256BLOCK_HPP
+
+#include <cstdint>
+
+/* Initial state */
+const uint32_t SHA256_IV[8] = {
+        0x6a09e667u, 0xbb67ae85u, 0x3c6ef372u, 0xa54ff53au, 0x510e527fu, 0x9b05688cu, 0x1f83d9abu, 0x5be0cd19u
+};
+
+/* Additive constant of every round */
+const uint32_t SHA256_K[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+/**
+ * SHA-256 of messages which fit in a single block.
+ * The 64 rounds run on a rolling window of 16 message schedule words.
+ */
+class SHA256Block {
+
+private:
+    static inline uint32_t rotr(uint32_t x, unsigned int s) {
+        return (x >> s) | (x << (32u - s));
+    }
+
+    /**
+     * Runs the 64 rounds on a block, then writes the first <size> bytes of the digest.
+     * @param w: The message words, overwritten by the message schedule.
+     */
+    static inline void compress(uint32_t *w, unsigned char *digest, unsigned int size) {
+        uint32_t x[8] = {SHA256_IV[0], SHA256_IV[1], SHA256_IV[2], SHA256_IV[3],
+                         SHA256_IV[4], SHA256_IV[5], SHA256_IV[6], SHA256_IV[7]};
+
+        #pragma GCC unroll 64
+        for (unsigned int i = 0; i < 64; ++i) {
+            if (i >= 16) {
+                uint32_t w15 = w[(i - 15) & 15u], w2 = w[(i - 2) & 15u];
+                w[i & 15u] += (rotr(w15, 7) ^ rotr(w15, 18) ^ (w15 >> 3u)) + w[(i - 7) & 15u]
+                              + (rotr(w2, 17) ^ rotr(w2, 19) ^ (w2 >> 10u));
+            }
+
+            uint32_t a = x[0], b = x[1], c = x[2], e = x[4], f = x[5], g = x[6];
+            uint32_t t1 = x[7] + (rotr(e, 6) ^ rotr(e, 11) ^ rotr(e, 25)) + (g ^ (e & (f ^ g)))
+                          + SHA256_K[i] + w[i & 15u];
+            uint32_t t2 = (rotr(a, 2) ^ rotr(a, 13) ^ rotr(a, 22)) + ((a & b) | (c & (a | b)));
+
+            x[7] = g;
+            x[6] = f;
+            x[5] = e;
+            x[4] = x[3] + t1;
+            x[3] = c;
+            x[2] = b;
+            x[1] = a;
+            x[0] = t1 + t2;
+        }
+
+        for (unsigned int i = 0; i < size; ++i)
+            digest[i] = (unsigned char) ((x[i >> 2u] + SHA256_IV[i >> 2u]) >> (24 - ((i & 3u) << 3u)));
+    }
+
+public:
+    /* Longest message that fits in a single block */
+    static const unsigned int MAX_LEN = 55;
+
+    /* Size of a whole digest */
+    static const unsigned int DIGEST_SIZE = 32;
+
+    /**
+     * Hashes a message.
+     * @param msg: The message.
+     * @param len: The length of the message, at most MAX_LEN.
+     * @param digest: Placeholder for the first <size> bytes of the digest.
+     * @param size: Bytes of the digest to write, at most DIGEST_SIZE.
+     */
+    static inline void hash(unsigned char const *msg, unsigned int len, unsigned char *digest, unsigned int size) {
+        uint32_t w[16] = {};
+
+        for (unsigned int i = 0; i < len; ++i)
+            w[i >> 2u] |= (uint32_t) msg[i] << (24 - ((i & 3u) << 3u));
+        w[len >> 2u] |= 0x80u << (24 - ((len & 3u) << 3u));
+        w[15] = len << 3u;
+
+        compress(w, digest, size);
+    }
+
+    /**
+     * Hashes a message whose length is known at compile time, so that its
+     * words are loaded with constant shifts, unrolled.
+     * @tparam Len: The length of the message, at most MAX_LEN.
+     */
+    template <unsigned int Len>
+    static inline void hashFixed(unsigned char const *msg, unsigned char *digest, unsigned int size) {
+        static_assert(Len <= MAX_LEN, "The message must fit in a single block.");
+
+        uint32_t w[16] = {};
+
+        #pragma GCC unroll 56
+        for (unsigned int i = 0; i < Len; ++i)
+            w[i >> 2u] |= (uint32_t) msg[i] << (24 - ((i & 3u) << 3u));
+        w[Len >> 2u] |= 0x80u << (24 - ((Len & 3u) << 3u));
+        w[15] = Len << 3u;
+
+        compress(w, digest, size);
+    }
+};
+
+#endif //RAINBOWHACKING_SHA256BLOCK_HPP
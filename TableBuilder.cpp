@@ -4,22 +4,27 @@
 
 #include "TableBuilder.hpp"
 #include <algorithm>
+#include <iostream>
 
 
 /** TableBuilder implementation **/
 
 TableBuilder::TableBuilder() {
     tableToBuild = nullptr;
+    perfect = false;
 }
 
-TableBuilder::TableBuilder(unsigned int nChains, Table *tableToBuild) {
+TableBuilder::TableBuilder(unsigned int nChains, unsigned int pwdLen, Table *tableToBuild, unsigned int nChecks) {
     this->tableToBuild = tableToBuild;
+    this->perfect = false;
 
     if (!tableToBuild) {
-        init(nChains);
+        init(nChains, pwdLen, nChecks);
     } else {
+        this->tableToBuild->own();
         nChains += this->tableToBuild->size();
-        this->tableToBuild->table->reserve(nChains);
+        this->tableToBuild->ends.reserve(nChains);
+        this->tableToBuild->starts.reserve((size_t) nChains * pwdLen);
     }
 }
 
@@ -27,96 +32,468 @@ TableBuilder::~TableBuilder() {
     delete tableToBuild;
 }
 
-TableBuilder* TableBuilder::init(unsigned int nChains) {
+TableBuilder* TableBuilder::init(unsigned int nChains, unsigned int pwdLen, unsigned int nChecks) {
     clear();
-    tableToBuild = new Table(nChains);
+    tableToBuild = new Table(nChains, pwdLen, nChecks);
 
     return this;
 }
 
-TableBuilder* TableBuilder::insert(Chain *chain) {
+TableBuilder* TableBuilder::insert(Password const &pwd, unsigned char const *hash) {
 
-    tableToBuild->table->push_back(chain);
+    set(append(1), pwd, hash);
 
     return this;
 }
 
 TableBuilder* TableBuilder::insert(std::string const &pwd, unsigned char const *hash) {
 
-    auto *chain = new Chain(pwd, hash);
+    Password p{};
+    p.set(pwd);
 
-    return insert(chain);
+    return insert(p, hash);
+}
+
+size_t TableBuilder::append(unsigned int n) {
+    size_t first = tableToBuild->size();
+
+    tableToBuild->ends.resize(first + n);
+    tableToBuild->starts.resize((first + n) * tableToBuild->pwdLen);
+    if (tableToBuild->nChecks > 0)
+        tableToBuild->pendingChecks.resize(first + n);
+
+    return first;
+}
+
+void TableBuilder::set(size_t i, Password const &pwd, unsigned char const *hash, uint64_t checks) {
+    tableToBuild->ends[i] = Endpoint(hash);
+    pwd.store(&tableToBuild->starts[i * tableToBuild->pwdLen], tableToBuild->pwdLen);
+    if (tableToBuild->nChecks > 0)
+        tableToBuild->pendingChecks[i] = checks;
 }
 
 Table* TableBuilder::build() {
 
-    std::sort(tableToBuild->table->begin(), tableToBuild->table->end(),
-              [](Chain *a, Chain *b) { return (a->compare(b) < 0); }
-              );
+    struct Row {
+        Endpoint end;
+        size_t index;
+    };
+
+    std::vector<Endpoint> &ends = tableToBuild->ends;
+    std::vector<unsigned char> &starts = tableToBuild->starts;
+    std::vector<uint64_t> &checks = tableToBuild->pendingChecks;
+    const unsigned int pwdLen = tableToBuild->pwdLen;
 
     Table *completeTable = tableToBuild;
     tableToBuild = nullptr;
 
+    // Tables read back from a file usually are sorted already.
+    if (std::is_sorted(ends.begin(), ends.end())) {
+        if (perfect)
+            removeDuplicates(completeTable);
+        completeTable->packChecks();
+        completeTable->buildFilter();
+        completeTable->buildDirectory();
+        return completeTable;
+    }
+
+    // Sort the end hashes along with their original position, then move
+    // the start passwords accordingly.
+    std::vector<Row> rows(ends.size());
+
+    for (size_t i = 0; i < rows.size(); ++i)
+        rows[i] = {ends[i], i};
+
+    std::sort(rows.begin(), rows.end(),
+              [](Row const &a, Row const &b) { return a.end < b.end; }
+              );
+
+    std::vector<unsigned char> sortedStarts(starts.size());
+    std::vector<uint64_t> sortedChecks(checks.size());
+
+    for (size_t i = 0; i < rows.size(); ++i) {
+        ends[i] = rows[i].end;
+        memcpy(&sortedStarts[i * pwdLen], &starts[rows[i].index * pwdLen], pwdLen);
+        if (!checks.empty())
+            sortedChecks[i] = checks[rows[i].index];
+    }
+
+    starts.swap(sortedStarts);
+    checks.swap(sortedChecks);
+
+    if (perfect)
+        removeDuplicates(completeTable);
+    completeTable->packChecks();
+    completeTable->buildFilter();
+    completeTable->buildDirectory();
+
     return completeTable;
 }
 
+TableBuilder* TableBuilder::setPerfect(bool perfect) {
+    this->perfect = perfect;
+    return this;
+}
+
+TableBuilder* TableBuilder::setFilter(unsigned int bitsPerChain) {
+    tableToBuild->filterBits = bitsPerChain;
+    return this;
+}
+
+TableBuilder* TableBuilder::setDirectory(bool enabled, unsigned int zeroBits) {
+    tableToBuild->withDirectory = enabled;
+    tableToBuild->directoryZeroBits = zeroBits;
+    return this;
+}
+
+void TableBuilder::removeDuplicates(Table *table) {
+    std::vector<Endpoint> &ends = table->ends;
+    std::vector<unsigned char> &starts = table->starts;
+    std::vector<uint64_t> &checks = table->pendingChecks;
+    const unsigned int pwdLen = table->pwdLen;
+
+    if (ends.empty())
+        return;
+
+    // Keep the first chain of every run of equal end hashes.
+    size_t kept = 1;
+
+    for (size_t i = 1; i < ends.size(); ++i) {
+        if (ends[i] == ends[kept - 1])
+            continue;
+
+        if (i != kept) {
+            ends[kept] = ends[i];
+            memcpy(&starts[kept * pwdLen], &starts[i * pwdLen], pwdLen);
+            if (!checks.empty())
+                checks[kept] = checks[i];
+        }
+        ++kept;
+    }
+
+    ends.resize(kept);
+    starts.resize(kept * pwdLen);
+    if (!checks.empty())
+        checks.resize(kept);
+}
+
 TableBuilder* TableBuilder::clear() {
     delete tableToBuild;
+    tableToBuild = nullptr;
     return this;
 }
 
 
 /** Table implementation **/
 
-Table::Table(unsigned int nChains) {
-    table = new std::vector<Chain*>();
-    table->reserve(nChains);
+Table::Table(unsigned int nChains, unsigned int pwdLen, unsigned int nChecks) {
+    this->pwdLen = pwdLen;
+    this->nChecks = nChecks;
+    this->filterBits = 0;
+    this->withDirectory = false;
+    this->directoryZeroBits = 0;
+    compactIndex = nullptr;
+    endsView = nullptr;
+    startsView = nullptr;
+    nViewed = 0;
+    mapping = nullptr;
+    ends.reserve(nChains);
+    starts.reserve((size_t) nChains * pwdLen);
 }
 
 Table::~Table() {
     clear();
-    delete table;
 }
 
 void Table::clear() {
-    for(auto chain: *table)
-        delete chain;
+    ends.clear();
+    starts.clear();
+    delete compactIndex;
+    compactIndex = nullptr;
+    endsView = nullptr;
+    startsView = nullptr;
+    nViewed = 0;
+    delete mapping;
+    mapping = nullptr;
+}
+
+void Table::own() {
+    if (endsView) {
+        std::vector<Endpoint> ownedEnds(endsView, endsView + nViewed);
+        std::vector<unsigned char> ownedStarts(startsView, startsView + (size_t) nViewed * pwdLen);
+
+        checks = checks.copy();
+        clear();
+        ends.swap(ownedEnds);
+        starts.swap(ownedStarts);
+
+        // Rebuilt by TableBuilder::build() along with the new chains.
+        filter = BloomFilter();
+        directory = BucketDirectory();
+    }
+
+    // Packed bits cannot be filled concurrently, so rows are built with a word each.
+    if (nChecks > 0 && pendingChecks.size() < size()) {
+        pendingChecks.resize(size());
+        for (size_t i = 0; i < size(); ++i)
+            pendingChecks[i] = checks.get(i);
+    }
+}
+
+void Table::buildFilter() {
+    if (filterBits == 0) {
+        filter = BloomFilter();
+        return;
+    }
+
+    filter = BloomFilter(size(), filterBits);
+
+    Endpoint const *end = endData();
+    for (size_t i = 0; i < size(); ++i)
+        filter.add(end[i].hi, end[i].lo);
+}
+
+void Table::buildDirectory() {
+    if (!withDirectory || compactIndex) {
+        directory = BucketDirectory();
+        return;
+    }
+
+    directory = BucketDirectory(BucketDirectory::defaultBits(size(), directoryZeroBits), directoryZeroBits);
+
+    Endpoint const *end = endData();
+    for (size_t i = 0; i < size(); ++i)
+        directory.add(i, end[i].hi);
+    directory.finish(size());
+}
+
+void Table::packChecks() {
+    if (nChecks == 0)
+        return;
+
+    checks = BitArray(pendingChecks.size(), nChecks);
+    for (size_t i = 0; i < pendingChecks.size(); ++i)
+        checks.set(i, pendingChecks[i]);
+
+    pendingChecks.clear();
+    pendingChecks.shrink_to_fit();
+}
+
+size_t Table::size() const {
+    if (compactIndex)
+        return compactIndex->size();
+
+    return endsView ? nViewed : ends.size();
+}
+
+bool Table::compact(Keyspace const &keyspace, unsigned int suffixBits, unsigned int zeroBits,
+                    uint64_t startOffset) {
+    // A compact index counts its chains in 32 bits.
+    if (size() > UINT32_MAX) {
+        std::cerr << "The table has too many chains for a compact index." << std::endl;
+        return false;
+    }
+
+    // Start passwords are stored as their index, which an imported table may not have.
+    unsigned int bad;
+    if (!CompactIndex::canIndex(startData(), size(), keyspace, bad)) {
+        std::cerr << "The start password of chain " << bad << " is not in the keyspace of the table." << std::endl;
+        return false;
+    }
+
+    auto *index = new CompactIndex(endData(), startData(), size(), keyspace, suffixBits, zeroBits, startOffset);
+
+    // The checkpoint bits and the filter are kept as they are, chains staying in the same order.
+    // The buckets of the index replace the directory.
+    checks = checks.copy();
+    filter = filter.copy();
+    directory = BucketDirectory();
+    withDirectory = false;
+    clear();
+    compactIndex = index;
+
+    ends.shrink_to_fit();
+    starts.shrink_to_fit();
+    return true;
+}
+
+size_t Table::memoryUsage() const {
+    size_t extra = checks.memoryUsage() + filter.memoryUsage() + directory.memoryUsage();
+
+    if (compactIndex)
+        return compactIndex->memoryUsage() + extra;
+
+    if (endsView)
+        return (size_t) nViewed * (sizeof(Endpoint) + pwdLen) + extra;
+
+    return ends.capacity() * sizeof(Endpoint) + starts.capacity() + extra;
+}
+
+unsigned int Table::findPassword(unsigned char const *hash, size_t &first) const {
+
+    Endpoint end(hash);
+
+    // Most end hashes looked up are not in the table: the filter rejects
+    // them with a single cache line, instead of a whole binary search.
+    if (!filter.mayContain(end.hi, end.lo)) {
+        first = 0;
+        return 0;
+    }
+
+    if (compactIndex)
+        return compactIndex->find(end, first);
+
+    Endpoint const *begin = endData();
+    Endpoint const *last = begin + size();
+    Endpoint const *lo;
+
+    if (directory.empty()) {
+        lo = std::lower_bound(begin, last, end);
+    } else {
+        // A bucket holds a few chains: the search is over within a cache line or two.
+        size_t b = directory.bucket(end.hi);
+        lo = std::lower_bound(begin + directory.offset(b), begin + directory.offset(b + 1), end);
+    }
+
+    first = lo - begin;
+
+    unsigned int n = 0;
+
+    while (lo != last && *lo == end) {
+        ++lo;
+        ++n;
+    }
+
+    return n;
 }
 
-unsigned int Table::size() const {
-    return table->size();
+void Table::findPasswords(unsigned char const *hashes, unsigned int n, size_t *first,
+                          unsigned int *counts) const {
+    Endpoint ends[PROBE_GROUP];
+
+    for (unsigned int g = 0; g < n; g += PROBE_GROUP) {
+        unsigned int m = n - g < PROBE_GROUP ? n - g : PROBE_GROUP;
+
+        for (unsigned int i = 0; i < m; ++i)
+            ends[i] = Endpoint(hashes + (size_t) (g + i) * HASH_SIZE);
+
+        findGroup(ends, m, first + g, counts + g);
+    }
 }
 
-std::ostream& Table::printTo(std::ostream& stream) const {
-    // unsigned char hash[HASH_SIZE];
+void Table::findGroup(Endpoint const *ends, unsigned int n, size_t *first, unsigned int *counts) const {
+    unsigned int live[PROBE_GROUP];     /* Hashes the filter lets through */
+    size_t base[PROBE_GROUP];           /* Start of the range searched for every live hash */
+    unsigned int nLive = 0;
+
+    // Load all the filter blocks at once, then reject the misses.
+    for (unsigned int i = 0; i < n; ++i)
+        filter.prefetch(ends[i].lo);
 
-    // For every hash-password pair, print it to the stream.
-    for(auto chain: *table) {
-        // chain->getHash(hash);
-        stream << chain->getPwd() << " " << chain->getHashStr() << std::endl;
+    for (unsigned int i = 0; i < n; ++i) {
+        first[i] = 0;
+        counts[i] = 0;
+        if (filter.mayContain(ends[i].hi, ends[i].lo))
+            live[nLive++] = i;
     }
 
-    return stream;
+    if (compactIndex) {
+        for (unsigned int k = 0; k < nLive; ++k)
+            counts[live[k]] = compactIndex->find(ends[live[k]], first[live[k]]);
+        return;
+    }
+
+    Endpoint const *begin = endData();
+    const size_t size = this->size();
+
+    if (!directory.empty()) {
+        size_t end[PROBE_GROUP];
+
+        for (unsigned int k = 0; k < nLive; ++k)
+            directory.prefetch(directory.bucket(ends[live[k]].hi));
+
+        for (unsigned int k = 0; k < nLive; ++k) {
+            size_t b = directory.bucket(ends[live[k]].hi);
+            base[k] = directory.offset(b);
+            end[k] = directory.offset(b + 1);
+            __builtin_prefetch(begin + base[k]);
+        }
+
+        // The buckets are loaded: search them.
+        for (unsigned int k = 0; k < nLive; ++k)
+            base[k] = std::lower_bound(begin + base[k], begin + end[k], ends[live[k]]) - begin;
+    } else if (size > 0) {
+        // Binary searches over the same length, one step of all of them at a time.
+        for (unsigned int k = 0; k < nLive; ++k)
+            base[k] = 0;
+
+        for (size_t len = size; len > 1;) {
+            size_t half = len / 2;
+            len -= half;
+
+            for (unsigned int k = 0; k < nLive; ++k) {
+                if (begin[base[k] + half] < ends[live[k]])
+                    base[k] += half;
+                __builtin_prefetch(begin + base[k] + len / 2);
+            }
+        }
+
+        for (unsigned int k = 0; k < nLive; ++k) {
+            if (begin[base[k]] < ends[live[k]])
+                ++base[k];
+        }
+    } else {
+        return;
+    }
+
+    for (unsigned int k = 0; k < nLive; ++k) {
+        unsigned int i = live[k];
+        first[i] = base[k];
+        while (base[k] + counts[i] < size && begin[base[k] + counts[i]] == ends[i])
+            ++counts[i];
+    }
 }
 
-std::vector<std::string> Table::findPassword(unsigned char const *hash) const {
+unsigned int Table::findPasswordFrom(Endpoint const &end, size_t from, size_t &first) const {
 
-    auto low_comp = [](Chain *it, unsigned char const *val) { return (it->compare(val) < 0); };
-    auto up_comp = [](unsigned char const *val, Chain *it) { return (0 < it->compare(val)); };
+    if (!filter.mayContain(end.hi, end.lo)) {
+        first = from;
+        return 0;
+    }
 
-    auto lo = std::lower_bound(table->begin(), table->end(), hash, low_comp);
-    auto hi = std::upper_bound(table->begin(), table->end(), hash, up_comp);
+    // Buckets already make compact lookups sequential.
+    if (compactIndex)
+        return compactIndex->find(end, first);
 
-    std::vector<std::string> passwords;
+    Endpoint const *begin = endData();
+    const size_t n = size();
 
-    unsigned int size = std::distance(lo, hi);
+    size_t lo = from, hi = from, step = 1;
 
-    if (size > 0) {
-        passwords.reserve(size);
+    if (!directory.empty()) {
+        // The bucket bounds the search, wherever <from> is.
+        size_t b = directory.bucket(end.hi);
+        lo = directory.offset(b) > from ? directory.offset(b) : from;
+        hi = directory.offset(b + 1) > lo ? directory.offset(b + 1) : lo;
+    } else {
+        // Gallop forward, then search the last step only.
+        while (hi < n && begin[hi] < end) {
+            lo = hi + 1;
+            hi = n - hi > step ? hi + step : n;
+            step *= 2;
+        }
+    }
+
+    Endpoint const *found = std::lower_bound(begin + lo, begin + hi, end);
 
-        for (auto it = lo; it != hi; ++it)
-            passwords.push_back((*it)->getPwd());
+    first = found - begin;
+
+    unsigned int count = 0;
+
+    while (found != begin + n && *found == end) {
+        ++found;
+        ++count;
     }
 
-    return passwords;
-}
\ No newline at end of file
+    return count;
+}
@@ -5,15 +5,70 @@
 #ifndef RAINBOWHACKING_TABLEBUILDER_HPP
 #define RAINBOWHACKING_TABLEBUILDER_HPP
 
+#include <cstdint>
 #include <cstring>
 #include <vector>
 #include <string>
 #include <fstream>
 #include "HashMethod.hpp"
+#include "CompactIndex.h"
+#include "BloomFilter.hpp"
+#include "BucketDirectory.hpp"
+#include "MappedFile.h"
+
+#define MAX_CHECKPOINTS 64  /* Checkpoint bits per chain, so that they fit in a word */
+#define PROBE_GROUP 32      /* End hashes whose searches are interleaved by Table::findPasswords() */
+#define MAX_DP_BITS 32      /* Zero bits of a distinguished point, so that compact buckets select on the others */
 
-class Chain;  // Defined below the definition of Table
 class Table;  // Structure storing hash-password pairs
 
+/**
+ * End hash of a chain, as two 64 bits big-endian halves, so that comparing
+ * endpoints as integers orders them like their bytes.
+ */
+struct Endpoint {
+    uint64_t hi;
+    uint64_t lo;
+
+    Endpoint() = default;
+
+    /**
+     * Constructor
+     * @param hash: The end hash, of HASH_SIZE bytes.
+     */
+    explicit Endpoint(unsigned char const *hash) {
+        hi = 0;
+        lo = 0;
+        for (int i = 0; i < 8; ++i) {
+            hi = (hi << 8u) | hash[i];
+            lo = (lo << 8u) | hash[i + 8];
+        }
+    }
+
+    /**
+     * Converts back to a hash.
+     * @param hash: Placeholder for the HASH_SIZE bytes.
+     */
+    void getHash(unsigned char *hash) const {
+        for (int i = 0; i < 8; ++i) {
+            hash[i] = (unsigned char) (hi >> (56u - 8u * i));
+            hash[i + 8] = (unsigned char) (lo >> (56u - 8u * i));
+        }
+    }
+
+    bool operator<(Endpoint const &other) const {
+        return hi < other.hi || (hi == other.hi && lo < other.lo);
+    }
+
+    bool operator==(Endpoint const &other) const {
+        return hi == other.hi && lo == other.lo;
+    }
+
+    bool operator!=(Endpoint const &other) const {
+        return !(*this == other);
+    }
+};
+
 /**
  * Table builder
  */
@@ -21,23 +76,38 @@ class TableBuilder {
 
 private:
     Table* tableToBuild;
+    bool perfect;   /* Whether build() keeps a single chain per end hash */
+
+    /**
+     * Removes the chains whose end hash is the same as the previous one.
+     * @param table: A sorted table, with owned arrays.
+     */
+    static void removeDuplicates(Table *table);
 
 public:
 
     TableBuilder();
 
-    explicit TableBuilder(unsigned int nChains, Table *tableToBuild = nullptr);
+    /**
+     * Constructor
+     * @param nChains: Number of chains to reserve room for.
+     * @param pwdLen: Length of the start passwords.
+     * @param tableToBuild: Table to extend, or nullptr for a new table.
+     * @param nChecks: Checkpoint bits per chain of a new table, at most MAX_CHECKPOINTS.
+     */
+    TableBuilder(unsigned int nChains, unsigned int pwdLen, Table *tableToBuild = nullptr, unsigned int nChecks = 0);
 
     ~TableBuilder();
 
-    TableBuilder* init(unsigned int nChains);
+    TableBuilder* init(unsigned int nChains, unsigned int pwdLen, unsigned int nChecks = 0);
 
     /**
      *
-     * @param chain
+     * @param pwd
+     * @param hash
      * @return
      */
-    TableBuilder* insert(Chain *chain);
+    TableBuilder* insert(Password const &pwd, unsigned char const *hash);
 
     /**
      *
@@ -47,11 +117,49 @@ public:
      */
     TableBuilder* insert(std::string const &pwd, unsigned char const *hash);
 
+    /**
+     * Appends <n> rows, to be filled with set().
+     * @param n: Number of rows.
+     * @return The index of the first new row.
+     */
+    size_t append(unsigned int n);
+
+    /**
+     * Fills a row. Distinct rows can be filled concurrently.
+     * @param i: Index of the row.
+     * @param pwd: Start password.
+     * @param hash: End hash.
+     * @param checks: Checkpoint bits of the chain, if the table has any.
+     */
+    void set(size_t i, Password const &pwd, unsigned char const *hash, uint64_t checks = 0);
+
     /**
      * Clear the table.
      */
     TableBuilder* clear();
 
+    /**
+     * Makes build() keep a single chain per end hash, so that the table
+     * is perfect: chains that merged are only regenerated once per lookup.
+     * @param perfect: true for a perfect table.
+     */
+    TableBuilder* setPerfect(bool perfect);
+
+    /**
+     * Makes build() add a filter over the end hashes to the table, which
+     * rejects most of the hashes looked up which are not in the table.
+     * @param bitsPerChain: Bits of the filter per chain, 0 for no filter.
+     */
+    TableBuilder* setFilter(unsigned int bitsPerChain);
+
+    /**
+     * Makes build() add a bucket directory to the table, so that end hashes
+     * are looked up in constant time rather than by binary search.
+     * @param enabled: Whether to add a directory.
+     * @param zeroBits: Top bits of every end hash known to be zero.
+     */
+    TableBuilder* setDirectory(bool enabled, unsigned int zeroBits = 0);
+
     /**
      * Build the table
      * @return
@@ -60,95 +168,200 @@ public:
 
 };
 
+/**
+ * Chains sorted by end hash, stored as two parallel arrays, or as a
+ * compact index once compact() has been called.
+ * The arrays are either owned, or read in place from a mapped table file.
+ */
 class Table {
 
 private:
-    std::vector<Chain*> *table;
+    std::vector<Endpoint> ends;         /* End hashes, sorted */
+    std::vector<unsigned char> starts;  /* Start passwords, <pwdLen> bytes each, null padded */
+    unsigned int pwdLen;
+    CompactIndex *compactIndex;         /* Replaces both arrays in compact mode */
+
+    unsigned int nChecks;               /* Checkpoint bits per chain, 0 if none */
+    BitArray checks;                    /* Checkpoint bits of every chain, in both modes */
+    std::vector<uint64_t> pendingChecks;    /* Checkpoint bits of the rows being built, a word each */
+
+    unsigned int filterBits;            /* Filter bits per chain, 0 if there is no filter */
+    BloomFilter filter;                 /* Filter over the end hashes, in both modes */
+
+    bool withDirectory;                 /* Whether build() adds a bucket directory */
+    unsigned int directoryZeroBits;     /* Top bits of the end hashes skipped by the directory */
+    BucketDirectory directory;          /* Buckets of the end hashes, in flat mode only */
+
+    Endpoint const *endsView;           /* Mapped end hashes, nullptr if the arrays are owned */
+    unsigned char const *startsView;    /* Mapped start passwords */
+    size_t nViewed;                     /* Number of mapped chains */
+    MappedFile *mapping;                /* File the views point into, if any */
 
     /**
      *
      */
      void clear();
 
-public:
-    explicit Table(unsigned int nChains);
-
-    ~Table();
-
-    unsigned int size() const;
+    /**
+     * Copies mapped arrays into owned ones, and unpacks the checkpoint bits,
+     * so that the table can be extended.
+     */
+    void own();
 
     /**
-     *
-     * @param hash
-     * @return
+     * Packs the checkpoint bits of the rows built.
      */
-    std::vector<std::string> findPassword(unsigned char const *hash) const;
+    void packChecks();
 
+    /**
+     * Builds the filter over the end hashes, if the table has one.
+     */
+    void buildFilter();
 
     /**
-     * Prints the content of the table to stream.
-     * @param stream: Output stream to write to.
-     * @return The output stream
+     * Builds the bucket directory of the end hashes, if the table has one.
      */
-    std::ostream& printTo(std::ostream &stream) const;
+    void buildDirectory();
 
-    friend class TableBuilder;
-};
+    /**
+     * findPasswords() of at most PROBE_GROUP end hashes.
+     */
+    void findGroup(Endpoint const *ends, unsigned int n, size_t *first, unsigned int *counts) const;
 
-class Chain {
+    Endpoint const *endData() const {
+        return endsView ? endsView : ends.data();
+    }
 
-private:
-    std::string _pwd;
-    unsigned char _hash[HASH_SIZE]{};
+    unsigned char const *startData() const {
+        return startsView ? startsView : starts.data();
+    }
 
 public:
-
     /**
      * Constructor
-     * @param pwd
-     * @param hash
+     * @param nChains: Number of chains to reserve room for.
+     * @param pwdLen: Length of the start passwords.
+     * @param nChecks: Checkpoint bits per chain, at most MAX_CHECKPOINTS.
+     */
+    Table(unsigned int nChains, unsigned int pwdLen, unsigned int nChecks = 0);
+
+    ~Table();
+
+    size_t size() const;
+
+    /**
+     * Replaces the arrays by a compact index. The table can no longer be extended.
+     * @param keyspace: The keyspace of the start passwords.
+     * @param suffixBits: Bits of every end hash to keep, besides the ones implied by the bucket.
+     * @param zeroBits: Top bits of every end hash known to be zero, not stored at all.
+     * @param startOffset: Index in the keyspace of the first start password of a counter.
+     * @return false, with the table left as it is, if a start password is not in the keyspace.
      */
-    Chain(std::string pwd, unsigned char const *hash) : _pwd(std::move(pwd)) {
-        memcpy(_hash, hash, HASH_SIZE);
+    bool compact(Keyspace const &keyspace, unsigned int suffixBits, unsigned int zeroBits = 0,
+                 uint64_t startOffset = 0);
+
+    /**
+     * @return true if the table is stored as a compact index.
+     */
+    bool isCompact() const {
+        return compactIndex != nullptr;
     }
 
     /**
-     * Password getter
-     * @return
+     * @return true if the table is read from a mapped file.
      */
-    std::string getPwd() const {
-        return _pwd;
+    bool isMapped() const {
+        return mapping != nullptr;
+    }
+
+    unsigned int getPwdLen() const {
+        return pwdLen;
     }
 
     /**
-     *
-     * @param hash
+     * @return the number of checkpoint bits stored per chain.
      */
-    void getHash(unsigned char *hash) const {
-        memcpy(hash, _hash, HASH_SIZE);
+    unsigned int getCheckBits() const {
+        return nChecks;
     }
 
-    std::string getHashStr() const {
-        return MD5Hash::convertHexString(_hash);
+    /**
+     * @return the bits of the end hash filter per chain, 0 if there is none.
+     */
+    unsigned int getFilterBits() const {
+        return filterBits;
     }
 
-    int compare(Chain const *chain) const {
-        unsigned char hash[HASH_SIZE];
-        chain->getHash(hash);
+    /**
+     * @return true if the end hashes are looked up through a bucket directory.
+     */
+    bool hasDirectory() const {
+        return !directory.empty();
+    }
 
-        return compare(hash);
+    /**
+     * Checkpoint bits getter
+     * @param i: Index of the chain.
+     * @return The checkpoint bits of the chain, the first checkpoint in the lowest bit.
+     */
+    uint64_t getChecks(size_t i) const {
+        return nChecks > 0 ? checks.get(i) : 0;
     }
 
-    int compare(unsigned char const *hash) const {
+    /**
+     * @return the memory used by the chains, in bytes.
+     */
+    size_t memoryUsage() const;
 
-        int i = 0;
+    /**
+     * Finds the chains ending with a hash.
+     * @param hash: The end hash.
+     * @param first: Placeholder for the index of the first chain found.
+     * @return The number of chains found (possibly 0, 1 or more).
+     */
+    unsigned int findPassword(unsigned char const *hash, size_t &first) const;
 
-        while (i < HASH_SIZE && hash[i] == _hash[i]) {
-            ++i;
-        }
+    /**
+     * Finds the chains ending with each of many hashes. Rather than one
+     * search after another, the searches of PROBE_GROUP hashes advance a
+     * step at a time together, prefetching the next step of every one of
+     * them, so that their cache misses overlap instead of adding up.
+     * @param hashes: The <n> end hashes, one after another.
+     * @param n: Number of hashes.
+     * @param first: Placeholder for the index of the first chain found, for every hash.
+     * @param counts: Placeholder for the number of chains found, for every hash.
+     */
+    void findPasswords(unsigned char const *hashes, unsigned int n, size_t *first, unsigned int *counts) const;
 
-        return i == HASH_SIZE ? 0 : _hash[i] - hash[i];
+    /**
+     * Finds the chains ending with an end hash, searching forward from a chain.
+     * Looking up sorted end hashes, each from the first chain found for the
+     * previous one, walks the table once from start to end.
+     * @param end: The end hash, not lower than the end hash of chain <from>.
+     * @param from: The chain to search from.
+     * @param first: Placeholder for the index of the first chain found.
+     * @return The number of chains found (possibly 0, 1 or more).
+     */
+    unsigned int findPasswordFrom(Endpoint const &end, size_t from, size_t &first) const;
+
+    /**
+     * Start password getter
+     * @param i: Index of the chain.
+     * @param pwd: Placeholder for the password.
+     */
+    void getStart(size_t i, Password &pwd) const {
+        if (compactIndex) {
+            compactIndex->getStart((unsigned int) i, pwd);
+        } else {
+            pwd.load(startData() + (size_t) i * pwdLen, pwdLen);
+        }
     }
+
+    friend class TableBuilder;
+    friend class TableFile;
+    friend class TextTableFile;
+    friend class ExternalTableBuilder;
+    friend class Benchmark;
 };
 
 #endif //RAINBOWHACKING_TABLEBUILDER_HPP
@@ -0,0 +1,393 @@
+#include "TableFile.h"
+#include <fstream>
+#include <iostream>
+#include <cstring>
+
+#define CHECKSUM_PRIME 0x9e3779b97f4a7c15ull
+
+Checksum::Checksum() : h{1, 2, 3, 4}, pending{}, nPending(0), size(0) {}
+
+void Checksum::update(void const *data, size_t n) {
+    auto const *bytes = static_cast<unsigned char const *>(data);
+    uint64_t w;
+    size_t i = 0;
+
+    size += n;
+
+    // Complete the block left over by the previous bytes first.
+    if (nPending > 0) {
+        size_t take = 32 - nPending < n ? 32 - nPending : n;
+        memcpy(pending + nPending, bytes, take);
+        nPending += take;
+        i = take;
+
+        if (nPending < 32)
+            return;
+
+        nPending = 0;
+        for (unsigned int l = 0; l < 4; ++l) {
+            memcpy(&w, pending + 8 * l, 8);
+            h[l] ^= w;
+            h[l] = ((h[l] << 31u) | (h[l] >> 33u)) * CHECKSUM_PRIME;
+        }
+    }
+
+    // Four independent lanes, so that the multiplications overlap.
+    for (; i + 32 <= n; i += 32) {
+        for (unsigned int l = 0; l < 4; ++l) {
+            memcpy(&w, bytes + i + 8 * l, 8);
+            h[l] ^= w;
+            h[l] = ((h[l] << 31u) | (h[l] >> 33u)) * CHECKSUM_PRIME;
+        }
+    }
+
+    memcpy(pending, bytes + i, n - i);
+    nPending = n - i;
+}
+
+uint64_t Checksum::digest() const {
+    uint64_t lanes[4] = {h[0], h[1], h[2], h[3]};
+
+    for (size_t i = 0; i < nPending; ++i)
+        lanes[0] = (lanes[0] ^ pending[i]) * CHECKSUM_PRIME;
+
+    uint64_t result = size;
+    for (uint64_t lane : lanes) {
+        result = (result ^ lane) * CHECKSUM_PRIME;
+        result ^= result >> 29u;
+    }
+
+    return result;
+}
+
+uint64_t TableFile::checksum(void const *data, size_t size) {
+    Checksum sum;
+    sum.update(data, size);
+    return sum.digest();
+}
+
+bool TableFile::isTableFile(std::string const &filePath) {
+    std::ifstream in(filePath.c_str(), std::ios::binary);
+    char magic[8];
+
+    return in.read(magic, sizeof(magic)) && memcmp(magic, TABLE_FILE_MAGIC, sizeof(magic)) == 0;
+}
+
+bool TableFile::hasTableExtension(std::string const &filePath) {
+    const std::string extension(TABLE_FILE_EXTENSION);
+
+    return filePath.size() >= extension.size()
+           && filePath.compare(filePath.size() - extension.size(), extension.size(), extension) == 0;
+}
+
+bool TableFile::writeSection(std::ofstream &out, TableFileHeader &header, uint32_t type,
+                             void const *data, size_t size) {
+    beginSection(out, header, type);
+    out.write(static_cast<char const *>(data), size);
+    endSection(out, header, checksum(data, size));
+
+    return (bool) out;
+}
+
+void TableFile::beginSection(std::ofstream &out, TableFileHeader &header, uint32_t type) {
+    static const char padding[TABLE_FILE_ALIGN] = {};
+
+    auto offset = (uint64_t) out.tellp();
+    size_t pad = (TABLE_FILE_ALIGN - offset % TABLE_FILE_ALIGN) % TABLE_FILE_ALIGN;
+
+    out.write(padding, pad);
+
+    TableSection &section = header.sections[header.nSections++];
+    section.type = type;
+    section.offset = offset + pad;
+}
+
+void TableFile::endSection(std::ofstream &out, TableFileHeader &header, uint64_t checksum) {
+    TableSection &section = header.sections[header.nSections - 1];
+    section.size = (uint64_t) out.tellp() - section.offset;
+    section.checksum = checksum;
+}
+
+bool TableFile::writeHeader(std::ofstream &out, TableFileHeader &header) {
+    memcpy(header.magic, TABLE_FILE_MAGIC, sizeof(header.magic));
+    header.version = TABLE_FILE_VERSION;
+    header.endian = TABLE_FILE_ENDIAN;
+    header.headerSize = sizeof(TableFileHeader);
+    header.checksum = checksum(&header, offsetof(TableFileHeader, checksum));
+
+    out.seekp(0);
+    out.write(reinterpret_cast<char const *>(&header), sizeof(header));
+
+    return (bool) out;
+}
+
+TableSection const *TableFile::findSection(TableFileHeader const &header, uint32_t type) {
+    for (unsigned int i = 0; i < header.nSections; ++i) {
+        if (header.sections[i].type == type)
+            return &header.sections[i];
+    }
+
+    return nullptr;
+}
+
+bool TableFile::write(std::string const &filePath, TableFileHeader &header, Table const &table) {
+    std::ofstream out(filePath.c_str(), std::ios::binary | std::ios::trunc);
+
+    if (!out) {
+        std::cerr << "Could not write to file \"" << filePath << "\"." << std::endl;
+        return false;
+    }
+
+    header.nChains = table.size();
+    header.nChains32 = 0;
+    header.filterBits = table.filter.empty() ? 0 : table.filterBits;
+    header.directoryBits = table.directory.getBits();
+    header.directoryZeroBits = table.directory.getZeroBits();
+    header.compactPrefixBits = 0;
+    header.compactSuffixBits = 0;
+    header.compactZeroBits = 0;
+    header.compactStartBits = 0;
+    header.nSections = 0;
+    memset(header.sections, 0, sizeof(header.sections));
+
+    // The header is written last, once the sections are known.
+    TableFileHeader placeholder{};
+    out.write(reinterpret_cast<char const *>(&placeholder), sizeof(placeholder));
+
+    const size_t n = table.size();
+    bool ok;
+
+    if (table.isCompact()) {
+        CompactIndex const &index = *table.compactIndex;
+        header.compactPrefixBits = index.getPrefixBits();
+        header.compactSuffixBits = index.getSuffixBits();
+        header.compactZeroBits = index.getZeroBits();
+        header.compactStartBits = index.getStartBits();
+
+        ok = writeSection(out, header, SECTION_COMPACT_BUCKETS, index.getBuckets(),
+                          CompactIndex::bucketCount(index.getPrefixBits()) * sizeof(uint32_t))
+             && writeSection(out, header, SECTION_COMPACT_SUFFIXES, index.getSuffixes().getWords(),
+                             index.getSuffixes().memoryUsage())
+             && writeSection(out, header, SECTION_COMPACT_STARTS, index.getStartIndices().getWords(),
+                             index.getStartIndices().memoryUsage());
+    } else {
+        ok = writeSection(out, header, SECTION_ENDS, table.endData(), n * sizeof(Endpoint))
+             && writeSection(out, header, SECTION_STARTS, table.startData(), n * table.pwdLen);
+
+        if (table.hasDirectory()) {
+            ok = ok && writeSection(out, header, SECTION_DIRECTORY, table.directory.getOffsets(),
+                                    table.directory.memoryUsage());
+        }
+    }
+
+    if (table.nChecks > 0) {
+        ok = ok && writeSection(out, header, SECTION_CHECKPOINTS, table.checks.getWords(),
+                                table.checks.memoryUsage());
+    }
+
+    if (header.filterBits > 0) {
+        ok = ok && writeSection(out, header, SECTION_FILTER, table.filter.getBlocks(),
+                                table.filter.memoryUsage());
+    }
+
+    ok = writeHeader(out, header) && ok;
+    out.close();
+
+    if (!ok || !out) {
+        std::cerr << "Could not write to file \"" << filePath << "\"." << std::endl;
+        return false;
+    }
+
+    return true;
+}
+
+bool TableFile::checkHeader(TableFileHeader &header, std::string const &filePath) {
+    if (memcmp(header.magic, TABLE_FILE_MAGIC, sizeof(header.magic)) != 0) {
+        std::cerr << "\"" << filePath << "\" is not a table file." << std::endl;
+        return false;
+    }
+
+    if (header.endian != TABLE_FILE_ENDIAN) {
+        std::cerr << "\"" << filePath << "\" was written on a machine of another byte order." << std::endl;
+        return false;
+    }
+
+    if (header.version > TABLE_FILE_VERSION || header.headerSize != sizeof(TableFileHeader)) {
+        std::cerr << "\"" << filePath << "\" has an unsupported version (" << header.version << ")." << std::endl;
+        return false;
+    }
+
+    if (header.checksum != checksum(&header, offsetof(TableFileHeader, checksum))
+        || header.nSections > TABLE_FILE_MAX_SECTIONS
+        || header.domainLen > TABLE_FILE_MAX_DOMAIN
+        || header.nCheckpoints > MAX_CHECKPOINTS
+        || header.hashMethod[TABLE_FILE_MAX_NAME - 1] != '\0') {
+        std::cerr << "\"" << filePath << "\" has a corrupted header." << std::endl;
+        return false;
+    }
+
+    if (header.version < 2)
+        header.nChains = header.nChains32;
+
+    return true;
+}
+
+Table *TableFile::open(std::string const &filePath, TableFileHeader &header) {
+    auto *mapping = new MappedFile(filePath);
+
+    if (!mapping->isOpen() || mapping->size() < sizeof(TableFileHeader)) {
+        std::cerr << "Could not read from file \"" << filePath << "\"." << std::endl;
+        delete mapping;
+        return nullptr;
+    }
+
+    memcpy(&header, mapping->data(), sizeof(header));
+
+    if (!checkHeader(header, filePath)) {
+        delete mapping;
+        return nullptr;
+    }
+
+    for (unsigned int i = 0; i < header.nSections; ++i) {
+        TableSection const &section = header.sections[i];
+        if (section.offset % TABLE_FILE_ALIGN != 0 || section.offset > mapping->size()
+            || section.size > mapping->size() - section.offset) {
+            std::cerr << "\"" << filePath << "\" is truncated." << std::endl;
+            delete mapping;
+            return nullptr;
+        }
+    }
+
+    const size_t n = header.nChains;
+    auto *table = new Table(0, header.pwdLen, header.nCheckpoints);
+    table->mapping = mapping;
+
+    // Every section must be there, with exactly the size implied by the header.
+    auto section = [&](uint32_t type, size_t size) -> void const * {
+        TableSection const *s = findSection(header, type);
+        return s && s->size == size ? mapping->data() + s->offset : nullptr;
+    };
+
+    bool ok;
+
+    if (header.pwdLen == 0 || header.pwdLen > MAX_PWD_SIZE || n > mapping->size()) {
+        ok = false;
+    } else if (header.compactPrefixBits == 0) {
+        table->endsView = static_cast<Endpoint const *>(section(SECTION_ENDS, n * sizeof(Endpoint)));
+        table->startsView = static_cast<unsigned char const *>(section(SECTION_STARTS, n * header.pwdLen));
+        table->nViewed = n;
+
+        ok = table->endsView && table->startsView;
+
+        if (ok && header.directoryBits > 0) {
+            unsigned int bits = header.directoryBits;
+            unsigned int zeroBits = header.directoryZeroBits;
+            auto const *offsets = static_cast<uint64_t const *>(
+                    bits <= DIRECTORY_MAX_BITS && zeroBits <= 32
+                    ? section(SECTION_DIRECTORY, BucketDirectory::entryCount(bits) * sizeof(uint64_t)) : nullptr);
+
+            ok = offsets && offsets[0] == 0 && offsets[BucketDirectory::entryCount(bits) - 1] == n;
+
+            if (ok) {
+                table->withDirectory = true;
+                table->directoryZeroBits = zeroBits;
+                table->directory = BucketDirectory(offsets, bits, zeroBits);
+            }
+        }
+    } else {
+        Keyspace keyspace(std::string(), 0);
+        bool validKeyspace = Keyspace::create(std::string(header.domain, header.domainLen),
+                                              std::string(header.mask, strnlen(header.mask, TABLE_FILE_MAX_MASK)),
+                                              header.minLen, header.pwdLen, keyspace);
+        unsigned int prefixBits = header.compactPrefixBits;
+        unsigned int suffixBits = header.compactSuffixBits;
+        unsigned int zeroBits = header.compactZeroBits;
+        // Files written before start indices had their own width used the keyspace bits.
+        unsigned int startBits = header.compactStartBits > 0 ? header.compactStartBits
+                                                             : CompactIndex::startBits(keyspace);
+
+        // A compact index counts its chains in 32 bits.
+        ok = validKeyspace && keyspace.size() != 0 && n <= UINT32_MAX && prefixBits <= 32 && zeroBits <= 32
+             && suffixBits >= 1 && suffixBits <= 64 - zeroBits - prefixBits && startBits <= 64;
+
+        if (ok) {
+            void const *buckets = section(SECTION_COMPACT_BUCKETS,
+                                          CompactIndex::bucketCount(prefixBits) * sizeof(uint32_t));
+            void const *suffixes = section(SECTION_COMPACT_SUFFIXES,
+                                           BitArray::wordCount(n, suffixBits) * sizeof(uint64_t));
+            void const *starts = section(SECTION_COMPACT_STARTS,
+                                         BitArray::wordCount(n, startBits) * sizeof(uint64_t));
+
+            ok = buckets && suffixes && starts;
+
+            if (ok) {
+                table->compactIndex = new CompactIndex(n, prefixBits, suffixBits,
+                                                       static_cast<uint32_t const *>(buckets),
+                                                       static_cast<uint64_t const *>(suffixes),
+                                                       static_cast<uint64_t const *>(starts), keyspace, zeroBits,
+                                                       startBits, header.startSeed % keyspace.size());
+            }
+        }
+    }
+
+    if (ok && header.nCheckpoints > 0) {
+        void const *checks = section(SECTION_CHECKPOINTS,
+                                     BitArray::wordCount(n, header.nCheckpoints) * sizeof(uint64_t));
+
+        ok = checks != nullptr;
+
+        if (ok)
+            table->checks = BitArray(static_cast<uint64_t const *>(checks), n, header.nCheckpoints);
+    }
+
+    if (ok && header.filterBits > 0) {
+        size_t nBlocks = BloomFilter::blockCount(n, header.filterBits);
+        void const *blocks = section(SECTION_FILTER, nBlocks * BLOOM_BLOCK_WORDS * sizeof(uint64_t));
+
+        ok = blocks != nullptr;
+
+        if (ok) {
+            table->filterBits = header.filterBits;
+            table->filter = BloomFilter(static_cast<uint64_t const *>(blocks), nBlocks);
+        }
+    }
+
+    if (!ok) {
+        std::cerr << "\"" << filePath << "\" has invalid sections." << std::endl;
+        delete table;
+        return nullptr;
+    }
+
+    return table;
+}
+
+bool TableFile::verify(std::string const &filePath) {
+    MappedFile mapping(filePath);
+    TableFileHeader header{};
+
+    if (!mapping.isOpen() || mapping.size() < sizeof(TableFileHeader)) {
+        std::cerr << "Could not read from file \"" << filePath << "\"." << std::endl;
+        return false;
+    }
+
+    memcpy(&header, mapping.data(), sizeof(header));
+
+    if (!checkHeader(header, filePath))
+        return false;
+
+    bool ok = true;
+
+    for (unsigned int i = 0; i < header.nSections; ++i) {
+        TableSection const &section = header.sections[i];
+
+        if (section.offset > mapping.size() || section.size > mapping.size() - section.offset) {
+            std::cerr << "Section " << i << " is truncated." << std::endl;
+            ok = false;
+        } else if (checksum(mapping.data() + section.offset, section.size) != section.checksum) {
+            std::cerr << "Section " << i << " is corrupted." << std::endl;
+            ok = false;
+        }
+    }
+
+    return ok;
+}
@@ -0,0 +1,211 @@
+#ifndef RAINBOWHACKING_TABLEFILE_H
+#define RAINBOWHACKING_TABLEFILE_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include "TableBuilder.hpp"
+
+#define TABLE_FILE_MAGIC "RBWTABLE"     /* First 8 bytes of every binary table file */
+#define TABLE_FILE_VERSION 2     /* 2: 64 bits chain count */
+#define TABLE_FILE_EXTENSION ".rbt"
+#define TABLE_FILE_ENDIAN 0x01020304u   /* Written natively, to detect files from a machine of other byte order */
+#define TABLE_FILE_ALIGN 64             /* Alignment of every section in the file */
+#define TABLE_FILE_MAX_SECTIONS 16
+#define TABLE_FILE_MAX_DOMAIN 256
+#define TABLE_FILE_MAX_NAME 16
+#define TABLE_FILE_MAX_MASK 128         /* Longest mask, null terminated: two characters per position */
+
+/* Kinds of sections a table file can hold */
+enum TableSectionType : uint32_t {
+    SECTION_ENDS = 1,               /* Sorted end hashes, as Endpoint */
+    SECTION_STARTS = 2,             /* Start passwords, <pwdLen> bytes each, null padded */
+    SECTION_COMPACT_BUCKETS = 3,    /* Bucket offsets of a compact index, as uint32_t */
+    SECTION_COMPACT_SUFFIXES = 4,   /* Truncated end hashes of a compact index, as packed words */
+    SECTION_COMPACT_STARTS = 5,     /* Start password indices of a compact index, as packed words */
+    SECTION_CHECKPOINTS = 6,        /* Checkpoint bits of every chain, as packed words */
+    SECTION_FILTER = 7,             /* Blocks of the filter over the end hashes, as uint64_t */
+    SECTION_DIRECTORY = 8           /* Offsets of the buckets of the end hashes, as uint64_t */
+};
+
+/**
+ * Location and checksum of a section of a table file.
+ */
+struct TableSection {
+    uint32_t type;
+    uint32_t reserved;
+    uint64_t offset;    /* From the start of the file, a multiple of TABLE_FILE_ALIGN */
+    uint64_t size;      /* In bytes */
+    uint64_t checksum;  /* TableFile::checksum() of the bytes of the section */
+};
+
+/**
+ * Header of a binary table file: one page at the very start of the file,
+ * followed by the sections it points to.
+ * Unused fields and reserved bytes are zero, so that later versions can
+ * add fields whose zero value keeps the current behaviour.
+ */
+struct TableFileHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t endian;
+    uint32_t headerSize;                    /* sizeof(TableFileHeader) */
+    uint32_t chainLen;
+    uint32_t nChains32;                     /* Number of chains of version 1 files, 0 since */
+    uint32_t pwdLen;
+    uint32_t tableIndex;                    /* Index of the table in a set of tables */
+    uint32_t domainLen;
+    char domain[TABLE_FILE_MAX_DOMAIN];     /* Not null terminated */
+    char hashMethod[TABLE_FILE_MAX_NAME];   /* Null terminated */
+    uint32_t compactPrefixBits;             /* 0 for a flat table */
+    uint32_t compactSuffixBits;
+    uint32_t nSections;
+    uint32_t reserved0;
+    TableSection sections[TABLE_FILE_MAX_SECTIONS];
+    uint32_t nCheckpoints;                  /* Checkpoint bits per chain, 0 if none */
+    uint32_t checkpoints[MAX_CHECKPOINTS];  /* Column of every checkpoint */
+    uint32_t perfect;                       /* 1 if all the end hashes are distinct */
+    uint32_t dpBits;                        /* Zero bits of a distinguished point, 0 for a rainbow table */
+    uint32_t compactZeroBits;               /* Top bits of the end hashes skipped by a compact index */
+    uint64_t nChains;                       /* Number of chains, read from nChains32 in version 1 files */
+    uint32_t filterBits;                    /* Bits of the end hash filter per chain, 0 if none */
+    uint32_t directoryBits;                 /* Bits selecting a bucket of the directory, 0 if none */
+    uint32_t directoryZeroBits;             /* Top bits of the end hashes skipped by the directory */
+    uint32_t compactStartBits;              /* Bits of every start index of a compact index, 0 for the keyspace bits */
+    uint64_t startSeed;                     /* Index in the keyspace of the start password of chain 0 */
+    uint64_t startCount;                    /* Start passwords used so far, 0 if they are not from a counter */
+    uint32_t reduction;                     /* Reduction function, REDUCE_BYTES for the tables of earlier versions */
+    uint32_t minLen;                        /* Length of the shortest passwords, 0 for pwdLen */
+    char mask[TABLE_FILE_MAX_MASK];         /* Charset of every position, null terminated, "" for the domain */
+    unsigned char reserved[2800];
+    uint64_t checksum;                      /* TableFile::checksum() of all the bytes above */
+};
+
+static_assert(sizeof(TableFileHeader) == 4096, "The header of a table file fills a page");
+
+/**
+ * TableFile::checksum() of bytes given a block at a time, for sections
+ * written as they are produced.
+ */
+class Checksum {
+
+private:
+    uint64_t h[4];              /* Lanes */
+    unsigned char pending[32];  /* Bytes not yet mixed into the lanes */
+    size_t nPending;
+    size_t size;                /* Bytes given so far */
+
+public:
+    Checksum();
+
+    /**
+     * Adds bytes.
+     * @param data: The bytes, following the ones given so far.
+     * @param size: Number of bytes.
+     */
+    void update(void const *data, size_t size);
+
+    /**
+     * @return the checksum of all the bytes given so far.
+     */
+    uint64_t digest() const;
+};
+
+/**
+ * Reads and writes tables in the binary format.
+ *
+ * A table is written already sorted, so loading it only maps the file:
+ * the table is usable immediately, its pages being read from disk when the
+ * lookups first touch them, and shared by every process using the table.
+ * Section checksums are only checked by verify(), which reads the whole file.
+ */
+class TableFile {
+
+private:
+    /**
+     * Writes a section at the next aligned offset, and records it in the header.
+     */
+    static bool writeSection(std::ofstream &out, TableFileHeader &header, uint32_t type,
+                             void const *data, size_t size);
+
+    /**
+     * Finds a section in a header.
+     * @return the section, or nullptr if there is none of this type.
+     */
+    static TableSection const *findSection(TableFileHeader const &header, uint32_t type);
+
+    /**
+     * Checks the magic, version, byte order and checksum of a header, then
+     * moves the fields of earlier versions to where the current one keeps them.
+     */
+    static bool checkHeader(TableFileHeader &header, std::string const &filePath);
+
+public:
+    /**
+     * Fast 64 bits checksum, not meant to resist tampering.
+     * @param data: The bytes to check.
+     * @param size: Number of bytes.
+     */
+    static uint64_t checksum(void const *data, size_t size);
+
+    /**
+     * @return true if the file starts with the magic of a binary table file.
+     */
+    static bool isTableFile(std::string const &filePath);
+
+    /**
+     * @return true if the path has the extension of a binary table file.
+     */
+    static bool hasTableExtension(std::string const &filePath);
+
+    /**
+     * Starts a section at the next aligned offset, its bytes to be written
+     * by the caller, so that sections too large for memory can be streamed.
+     * @param out: The file, with the header placeholder already written.
+     * @param header: The header, recording the section.
+     * @param type: The type of the section.
+     */
+    static void beginSection(std::ofstream &out, TableFileHeader &header, uint32_t type);
+
+    /**
+     * Ends the section started last, at the current position of the file.
+     * @param checksum: The checksum of the bytes of the section.
+     */
+    static void endSection(std::ofstream &out, TableFileHeader &header, uint64_t checksum);
+
+    /**
+     * Fills in the format fields of a header and its checksum, then writes
+     * it at the start of the file, once all the sections are written.
+     * @param out: The file.
+     * @param header: The header, with nChains and the sections filled in.
+     * @return true if the file has been written without error.
+     */
+    static bool writeHeader(std::ofstream &out, TableFileHeader &header);
+
+    /**
+     * Writes a table.
+     * @param filePath: The path of the file to write to.
+     * @param header: The parameters of the table: chainLen, pwdLen, tableIndex, domain,
+     *                hashMethod and checkpoints. The other fields, filterBits and directoryBits included, are filled in.
+     * @param table: The table to write.
+     * @return true if the table has been written.
+     */
+    static bool write(std::string const &filePath, TableFileHeader &header, Table const &table);
+
+    /**
+     * Maps a table.
+     * @param filePath: The path of the file to read from.
+     * @param header: Placeholder for the header of the file.
+     * @return The table, reading the file in place, or nullptr on error.
+     */
+    static Table *open(std::string const &filePath, TableFileHeader &header);
+
+    /**
+     * Reads a whole table file and checks the checksums of all its sections.
+     * @param filePath: The path of the file to check.
+     * @return true if the file is intact.
+     */
+    static bool verify(std::string const &filePath);
+};
+
+#endif //RAINBOWHACKING_TABLEFILE_H
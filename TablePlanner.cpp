@@ -0,0 +1,120 @@
+#include "TablePlanner.h"
+#include <algorithm>
+#include <climits>
+#include <cmath>
+#include <vector>
+
+double TablePlanner::keyspaceSize(Keyspace const &keyspace) {
+    double size = 0.0, count = 1.0;
+
+    for (unsigned int len = 1; len <= keyspace.pwdLen(); ++len) {
+        count *= keyspace.charset(len - 1).size();
+        if (len >= keyspace.minLen())
+            size += count;
+    }
+
+    return size;
+}
+
+TablePlan TablePlanner::evaluate(double n, unsigned int chainLen, double nChains, unsigned int nTables,
+                                 bool perfect, double bytesPerChain) {
+    TablePlan plan{};
+    const unsigned int t = chainLen > 0 ? chainLen : 1;
+    double m0 = nChains;
+
+    // The distinct passwords of column i are about 2N / (i + 2N / m0): a
+    // perfect table keeping <nChains> of them at its last column generates
+    // the m0 chains solving it. A saturated one stops once fewer than 1% of
+    // its new chains are kept, (m_t / m0)^2 of them, at about 18N / (t - 1)
+    // chains generated.
+    if (perfect) {
+        double inverse = 2.0 * n / nChains - (t - 1);
+        double saturated = t > 1 ? 18.0 * n / (t - 1) : n;
+        m0 = inverse > 0.0 ? std::min(2.0 * n / inverse, saturated) : saturated;
+    }
+
+    // Distinct passwords of every column, and the log of the probability
+    // that a password is in none of them.
+    std::vector<double> columns(t);
+    double mi = m0, logMiss = 0.0;
+
+    for (unsigned int i = 0; i < t; ++i) {
+        columns[i] = mi;
+        logMiss += std::log1p(-std::min(mi / n, 1.0));
+        mi = -n * std::expm1(-mi / n);
+    }
+
+    plan.chainLen = t;
+    plan.nChains = m0;
+    plan.nStored = perfect ? std::min(nChains, columns[t - 1]) : m0;
+
+    // The chains a perfect table keeps never merged: each of its columns holds nStored distinct passwords.
+    if (perfect) {
+        std::fill(columns.begin(), columns.end(), plan.nStored);
+        logMiss = t * std::log1p(-std::min(plan.nStored / n, 1.0));
+    }
+
+    plan.nTables = nTables;
+    plan.uniqueEnds = columns[t - 1] / m0;
+    plan.coverage = -std::expm1(logMiss);
+    plan.success = -std::expm1(nTables * logMiss);
+    plan.memory = nTables * plan.nStored * bytesPerChain;
+    plan.precomputation = nTables * m0 * t;
+
+    // Columns from the last one, the cheapest to walk, to the first one.
+    // Walking from column i merges into a chain at a later column j with
+    // probability m_j / N, a false alarm regenerating i + 1 steps.
+    double laterMiss = 1.0;     /* Probability of no merge after column i */
+    double searching = 1.0;     /* Probability that the hash is not found yet */
+
+    for (unsigned int i = t; i-- > 0;) {
+        double falseAlarm = 1.0 - laterMiss;
+        double cost = nTables * ((t - 1 - i) + falseAlarm * (i + 1));
+        double miss = std::pow(1.0 - std::min(columns[i] / n, 1.0), nTables);
+
+        plan.worstLookup += cost;
+        plan.falseAlarms += nTables * falseAlarm;
+        plan.averageLookup += searching * (cost + (1.0 - miss) * (i + 1));
+
+        searching *= miss;
+        laterMiss *= 1.0 - std::min(columns[i] / n, 1.0);
+    }
+
+    return plan;
+}
+
+bool TablePlanner::recommend(double n, unsigned int nTables, double memory, double target, bool perfect,
+                             double bytesPerChain, TablePlan &plan) {
+    // As many chains as the memory holds, but no more than passwords.
+    double nChains = std::min(std::floor(memory / (nTables * bytesPerChain)), std::min(n, (double) UINT_MAX));
+
+    if (nChains < 1.0) {
+        plan = TablePlan{};
+        plan.nTables = nTables;
+        return false;
+    }
+
+    // A perfect table of nChains distinct end hashes needs chains shorter than 2N / nChains + 1.
+    unsigned int hi = PLAN_MAX_CHAIN_LEN;
+    if (perfect)
+        hi = (unsigned int) std::max(1.0, std::min((double) hi, std::ceil(2.0 * n / nChains)));
+
+    plan = evaluate(n, hi, nChains, nTables, perfect, bytesPerChain);
+    if (plan.success < target)
+        return false;
+
+    // The success rate grows with the length of the chains.
+    unsigned int lo = 1;
+
+    while (lo < hi) {
+        unsigned int mid = lo + (hi - lo) / 2;
+
+        if (evaluate(n, mid, nChains, nTables, perfect, bytesPerChain).success >= target)
+            hi = mid;
+        else
+            lo = mid + 1;
+    }
+
+    plan = evaluate(n, hi, nChains, nTables, perfect, bytesPerChain);
+    return true;
+}
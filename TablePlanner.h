@@ -0,0 +1,79 @@
+#ifndef RAINBOWHACKING_TABLEPLANNER_H
+#define RAINBOWHACKING_TABLEPLANNER_H
+
+#include "Keyspace.hpp"
+
+#define PLAN_MAX_CHAIN_LEN 1000000  /* Longest chains the planner recommends, their lookup cost growing as its square */
+
+/**
+ * Expected results and costs of a set of rainbow tables.
+ * Costs are counted in chain steps (hash + reduce).
+ */
+struct TablePlan {
+    unsigned int chainLen;
+    double nChains;             /* Chains generated per table */
+    double nStored;             /* Chains stored per table, all of them unless the tables are perfect */
+    unsigned int nTables;
+
+    double uniqueEnds;          /* Distinct end hashes per chain generated, the others having merged */
+    double coverage;            /* Part of the keyspace a single table cracks */
+    double success;             /* Part of the keyspace the set of tables cracks */
+    double memory;              /* Bytes of all the tables */
+    double precomputation;      /* Chain steps to generate all the tables */
+    double worstLookup;         /* Chain steps to look a hash up in all the tables without finding it */
+    double averageLookup;       /* Chain steps to look up the hash of a random password, found or not */
+    double falseAlarms;         /* Chains regenerated in vain per hash not found */
+};
+
+/**
+ * Plans the parameters of rainbow tables from the size of their keyspace.
+ *
+ * The model is the classic one of rainbow tables whose reduction behaves
+ * like a random function: of m_i distinct passwords at column i, the next
+ * column holds m_{i+1} = N (1 - e^(-m_i / N)) distinct ones, N being the
+ * number of passwords. A table covers the distinct passwords of all its
+ * columns. A hash is looked up from its last column to its first one, the
+ * cheapest first, and every chain whose end hash matches is regenerated,
+ * in vain for a false alarm: a walk merging into a chain of the table.
+ *
+ * Checkpoints, filters and distinguished points are not modelled: the
+ * first two only cut the cost of the false alarms and of the lookups.
+ */
+class TablePlanner {
+
+public:
+    /**
+     * @return the number of passwords of a keyspace, even when it does not fit in 64 bits.
+     */
+    static double keyspaceSize(Keyspace const &keyspace);
+
+    /**
+     * Evaluates a set of tables.
+     * @param n: Number of passwords of the keyspace.
+     * @param chainLen: Length of the chains.
+     * @param nChains: Chains per table: generated, or stored if the tables are perfect.
+     * @param nTables: Number of tables of the set.
+     * @param perfect: Whether the tables keep a single chain per end hash.
+     * @param bytesPerChain: Memory of a chain of a table.
+     * @return The plan.
+     */
+    static TablePlan evaluate(double n, unsigned int chainLen, double nChains, unsigned int nTables,
+                              bool perfect, double bytesPerChain);
+
+    /**
+     * Recommends the shortest chains reaching a success rate, with as many
+     * chains as the memory holds, so that the lookups are the cheapest.
+     * @param n: Number of passwords of the keyspace.
+     * @param nTables: Number of tables of the set.
+     * @param memory: Bytes all the tables stay within.
+     * @param target: Success rate to reach, from 0 to 1.
+     * @param perfect: Whether the tables keep a single chain per end hash.
+     * @param bytesPerChain: Memory of a chain of a table.
+     * @param plan: Placeholder for the plan, the one of the highest success rate if the target cannot be reached.
+     * @return false if the target cannot be reached within the memory.
+     */
+    static bool recommend(double n, unsigned int nTables, double memory, double target, bool perfect,
+                          double bytesPerChain, TablePlan &plan);
+};
+
+#endif //RAINBOWHACKING_TABLEPLANNER_H
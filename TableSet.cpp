@@ -0,0 +1,165 @@
+#include "TableSet.h"
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+
+bool TableSet::add(RainbowTable const *table) {
+    if (!tables.empty()) {
+        RainbowTable const *first = tables[0];
+
+        if (table->pwdLen != first->pwdLen || table->hashMethod->name() != first->hashMethod->name()) {
+            std::cerr << "The tables of a set must hash passwords of the same length with the same method."
+                      << std::endl;
+            return false;
+        }
+    }
+
+    for (RainbowTable const *other : tables) {
+        if (other->tableIndex == table->tableIndex) {
+            std::cerr << "The set already holds a table of index " << table->tableIndex
+                      << ": it would find the same passwords." << std::endl;
+            return false;
+        }
+    }
+
+    tables.push_back(table);
+    return true;
+}
+
+std::string TableSet::crackHash(unsigned char const *targetHash) const {
+
+    std::string result;
+
+    std::vector<HashTarget> targets(tables.size());
+    std::vector<Work> works;
+
+    for (unsigned int t = 0; t < tables.size(); ++t) {
+        RainbowTable const &table = *tables[t];
+
+        table.hashMethod->prepareTarget(targetHash, table.pwdLen, targets[t]);
+
+        // A distinguished point table is a single walk, about 2^dpBits steps long.
+        if (table.dpBits > 0) {
+            unsigned long walk = (unsigned long) 1 << table.dpBits;
+            works.push_back({t, 0, 0, walk < table.chainLen ? walk : table.chainLen});
+            continue;
+        }
+
+        for (unsigned int hi = table.chainLen; hi > 0;) {
+            unsigned int lo = hi > LOOKUP_BATCH ? hi - LOOKUP_BATCH : 0;
+            works.push_back({t, lo, hi, table.chainLen - lo});
+            hi = lo;
+        }
+    }
+
+    // The cheapest columns of every table first, whatever the table.
+    std::stable_sort(works.begin(), works.end(),
+                     [](Work const &a, Work const &b) { return a.cost < b.cost; });
+
+    // Set by the thread which finds the password, so that the others stop.
+    std::atomic<bool> cancelled(false);
+
+    const long nWorks = works.size();
+
+    #pragma omp parallel for schedule(dynamic, 1) default(none) shared(result, targetHash, targets, works, cancelled, nWorks)
+    for (long w = 0; w < nWorks; ++w) {
+        if (cancelled.load(std::memory_order_relaxed))
+            continue;
+
+        Work const &work = works[w];
+        RainbowTable const &table = *tables[work.table];
+        Password pwd;
+
+        bool found = work.lo == work.hi ? table.crackDP(targetHash, pwd)
+                                        : table.crackColumns(targets[work.table], work.lo, work.hi, pwd, &cancelled);
+
+        // Only the first thread to find the password stores it.
+        if (found && !cancelled.exchange(true))
+            result = pwd.str();
+    }
+
+    return result;
+}
+
+std::string TableSet::crackPassword(std::string const &password) const {
+    unsigned char hash[HASH_SIZE];
+
+    if (tables.empty())
+        return "";
+
+    tables[0]->hashPassword(password, hash);
+
+    return crackHash(hash);
+}
+
+void TableSet::crackHashes(unsigned char const *hashes, unsigned int n, std::vector<std::string> &results) const {
+
+    results.assign(n, "");
+
+    std::vector<unsigned int> unsolved(n);
+    for (unsigned int t = 0; t < n; ++t)
+        unsolved[t] = t;
+
+    auto dropSolved = [&]() {
+        unsolved.erase(std::remove_if(unsolved.begin(), unsolved.end(),
+                                      [&results](unsigned int t) { return !results[t].empty(); }),
+                       unsolved.end());
+    };
+
+    // Distinguished point tables first: a single walk and probe per hash.
+    for (RainbowTable const *table : tables) {
+        if (table->dpBits == 0 || unsolved.empty())
+            continue;
+
+        std::vector<unsigned char> remaining(unsolved.size() * HASH_SIZE);
+        std::vector<std::string> found;
+
+        for (size_t i = 0; i < unsolved.size(); ++i)
+            memcpy(&remaining[i * HASH_SIZE], hashes + (size_t) unsolved[i] * HASH_SIZE, HASH_SIZE);
+
+        table->crackDPHashes(remaining.data(), unsolved.size(), found);
+
+        for (size_t i = 0; i < unsolved.size(); ++i) {
+            if (!found[i].empty())
+                results[unsolved[i]] = found[i];
+        }
+
+        dropSolved();
+    }
+
+    std::vector<std::vector<HashTarget>> targets(tables.size());
+    unsigned int longest = 0;
+
+    for (unsigned int t = 0; t < tables.size(); ++t) {
+        RainbowTable const &table = *tables[t];
+
+        if (table.dpBits > 0)
+            continue;
+
+        targets[t].resize(n);
+        for (unsigned int i = 0; i < n; ++i)
+            table.hashMethod->prepareTarget(hashes + (size_t) i * HASH_SIZE, table.pwdLen, targets[t][i]);
+
+        longest = table.chainLen > longest ? table.chainLen : longest;
+    }
+
+    // Bands of columns by their distance to the end, twice as wide every
+    // time, every band looked up in all the tables before the next one.
+    unsigned int width = LOOKUP_BATCH;
+
+    for (unsigned int from = 0; from < longest && !unsolved.empty(); from += width, width *= 2) {
+        for (unsigned int t = 0; t < tables.size() && !unsolved.empty(); ++t) {
+            RainbowTable const &table = *tables[t];
+
+            if (table.dpBits > 0 || from >= table.chainLen)
+                continue;
+
+            unsigned int hi = table.chainLen - from;
+            unsigned int lo = hi > width ? hi - width : 0;
+
+            table.crackBand(hashes, unsolved, targets[t], lo, hi, results);
+
+            dropSolved();
+        }
+    }
+}
@@ -0,0 +1,70 @@
+#ifndef RAINBOWHACKING_TABLESET_H
+#define RAINBOWHACKING_TABLESET_H
+
+#include <string>
+#include <vector>
+#include "RainbowTable.h"
+
+/**
+ * Set of tables looked up together.
+ *
+ * The tables differ by their table index, mixed into the reduction, so
+ * that they cover the keyspace independently: a hash missed by one of them
+ * is likely to be found by another. Rather than querying the tables one
+ * after another, lookups interleave their columns, cheapest first, and stop
+ * as soon as any table finds the password.
+ *
+ * The set does not own its tables.
+ */
+class TableSet {
+
+private:
+    /* Columns of a table, looked up together. */
+    struct Work {
+        unsigned int table;     /* Index of the table in the set */
+        unsigned int lo;        /* First column */
+        unsigned int hi;        /* End of the columns, lo for a distinguished point table */
+        unsigned long cost;     /* Steps to walk from the first column to the end */
+    };
+
+    std::vector<RainbowTable const *> tables;
+
+public:
+    /**
+     * Adds a table to the set.
+     * @param table: The table, hashing passwords of the same length with the same method as the others.
+     * @return false if the table cannot be looked up along with the others.
+     */
+    bool add(RainbowTable const *table);
+
+    unsigned int size() const {
+        return tables.size();
+    }
+
+    /**
+     * Looks a hash up in all the tables, columns of all the tables being
+     * handed out to the threads by increasing cost.
+     * @param targetHash: Hash to crack.
+     * @return A password if found, "" otherwise.
+     */
+    std::string crackHash(unsigned char const *targetHash) const;
+
+    /**
+     * Hashes a password and tries to crack it.
+     * @param password: Password to hash, and then to crack.
+     * @return The password if found, "" otherwise.
+     */
+    std::string crackPassword(std::string const &password) const;
+
+    /**
+     * Cracks many hashes at once. Every band of columns is looked up in all
+     * the tables before the next, more expensive one, and the hashes found
+     * are not walked any further.
+     * @param hashes: The <n> hashes to crack, one after another.
+     * @param n: Number of hashes.
+     * @param results: Placeholder for the n passwords, "" for the ones not found.
+     */
+    void crackHashes(unsigned char const *hashes, unsigned int n, std::vector<std::string> &results) const;
+};
+
+#endif //RAINBOWHACKING_TABLESET_H
@@ -0,0 +1,406 @@
+#include "TextTableFile.h"
+#include "Reduction.hpp"
+#include <omp.h>
+#include <algorithm>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <cstring>
+#include <cstdlib>
+#include <cerrno>
+#include <cctype>
+
+namespace {
+
+/* Value of every hexadecimal digit, -1 for the other characters */
+struct HexDigits {
+    signed char value[256];
+
+    HexDigits() : value() {
+        memset(value, -1, sizeof(value));
+        for (int i = 0; i < 10; ++i)
+            value['0' + i] = (signed char) i;
+        for (int i = 0; i < 6; ++i) {
+            value['a' + i] = (signed char) (10 + i);
+            value['A' + i] = (signed char) (10 + i);
+        }
+    }
+};
+
+const HexDigits HEX_DIGITS;
+
+inline bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+inline char const *skipBlanks(char const *p, char const *end) {
+    while (p < end && isBlank(*p))
+        ++p;
+    return p;
+}
+
+inline char const *skipToken(char const *p, char const *end) {
+    while (p < end && !isBlank(*p))
+        ++p;
+    return p;
+}
+
+}
+
+bool TextTableFile::decodeHex(char const *text, unsigned char *hash) {
+    int bad = 0;
+
+    for (int i = 0; i < HASH_SIZE; ++i) {
+        int hi = HEX_DIGITS.value[(unsigned char) text[2 * i]];
+        int lo = HEX_DIGITS.value[(unsigned char) text[2 * i + 1]];
+        // Invalid digits are negative, so they set the sign bit.
+        bad |= hi | lo;
+        hash[i] = (unsigned char) ((hi << 4) | lo);
+    }
+
+    return bad >= 0;
+}
+
+void TextTableFile::encodeHex(unsigned char const *hash, char *text) {
+    static const char digits[] = "0123456789ABCDEF";
+
+    for (int i = 0; i < HASH_SIZE; ++i) {
+        text[2 * i] = digits[hash[i] >> 4u];
+        text[2 * i + 1] = digits[hash[i] & 15u];
+    }
+}
+
+bool TextTableFile::decodeChecks(char const *text, unsigned int nDigits, uint64_t &checks) {
+    int bad = 0;
+
+    checks = 0;
+
+    for (unsigned int i = 0; i < nDigits; ++i) {
+        int digit = HEX_DIGITS.value[(unsigned char) text[i]];
+        bad |= digit;
+        checks = (checks << 4u) | (digit & 15u);
+    }
+
+    return bad >= 0;
+}
+
+void TextTableFile::encodeChecks(uint64_t checks, unsigned int nDigits, char *text) {
+    static const char digits[] = "0123456789ABCDEF";
+
+    for (unsigned int i = nDigits; i-- > 0; checks >>= 4u)
+        text[i] = digits[checks & 15u];
+}
+
+bool TextTableFile::parseList(std::string const &text, std::vector<unsigned int> &values) {
+    std::istringstream in(text);
+    std::string item;
+
+    values.clear();
+
+    while (std::getline(in, item, ',')) {
+        char *end;
+        unsigned long value = strtoul(item.c_str(), &end, 10);
+
+        if (item.empty() || *end != '\0' || value > UINT32_MAX)
+            return false;
+
+        values.push_back(value);
+    }
+
+    return true;
+}
+
+bool TextTableFile::parseNumber(std::string const &text, uint64_t &value) {
+    char *end;
+    errno = 0;
+    value = strtoull(text.c_str(), &end, 10);
+
+    return !text.empty() && isdigit((unsigned char) text[0]) && *end == '\0' && errno == 0;
+}
+
+std::string TextTableFile::formatList(unsigned int const *values, unsigned int n) {
+    std::ostringstream out;
+
+    for (unsigned int i = 0; i < n; ++i)
+        out << (i > 0 ? "," : "") << values[i];
+
+    return out.str();
+}
+
+size_t TextTableFile::parseChunk(char const *begin, char const *end, Table &table, size_t first, unsigned int minLen,
+                                 size_t &invalid) {
+    const unsigned int pwdLen = table.pwdLen;
+    const unsigned int checkDigits = (table.nChecks + 3) / 4;
+    unsigned char hash[HASH_SIZE];
+    uint64_t checks;
+    size_t row = first;
+
+    invalid = 0;
+
+    for (char const *p = begin; p < end; ) {
+        auto const *eol = static_cast<char const *>(memchr(p, '\n', end - p));
+        char const *lineEnd = eol ? eol : end;
+
+        char const *pwd = skipBlanks(p, lineEnd);
+        char const *pwdEnd = skipToken(pwd, lineEnd);
+        char const *hex = skipBlanks(pwdEnd, lineEnd);
+        char const *hexEnd = skipToken(hex, lineEnd);
+        char const *check = skipBlanks(hexEnd, lineEnd);
+        char const *checkEnd = skipToken(check, lineEnd);
+
+        if (pwd == lineEnd) {
+            // Blank line
+        } else if (pwdEnd - pwd >= minLen && pwdEnd - pwd <= pwdLen && hexEnd - hex == 2 * HASH_SIZE
+                   && checkEnd - check == checkDigits && skipBlanks(checkEnd, lineEnd) == lineEnd
+                   && decodeHex(hex, hash) && decodeChecks(check, checkDigits, checks)) {
+            table.ends[row] = Endpoint(hash);
+            memcpy(&table.starts[row * pwdLen], pwd, pwdEnd - pwd);
+            memset(&table.starts[row * pwdLen + (pwdEnd - pwd)], 0, pwdLen - (pwdEnd - pwd));
+            if (checkDigits > 0)
+                table.pendingChecks[row] = checks;
+            ++row;
+        } else {
+            ++invalid;
+        }
+
+        p = lineEnd + 1;
+    }
+
+    return row - first;
+}
+
+Table *TextTableFile::read(std::string const &filePath, TableFileHeader &header) {
+    MappedFile file(filePath);
+
+    if (!file.isOpen()) {
+        std::cerr << "Could not read from file \"" << filePath << "\"." << std::endl;
+        return nullptr;
+    }
+
+    auto const *begin = reinterpret_cast<char const *>(file.data());
+    char const *end = begin + file.size();
+
+    // Parameters, on the first line.
+    auto const *eol = static_cast<char const *>(memchr(begin, '\n', end - begin));
+    char const *body = eol ? eol + 1 : end;
+
+    std::istringstream params(std::string(begin, body));
+    uint64_t nChains;
+    std::string domain, hashMethodName;
+
+    if (!(params >> header.chainLen >> nChains >> domain >> header.pwdLen >> hashMethodName)
+        || header.pwdLen == 0 || header.pwdLen > MAX_PWD_SIZE
+        || domain.size() > TABLE_FILE_MAX_DOMAIN || hashMethodName.size() >= TABLE_FILE_MAX_NAME) {
+        std::cerr << "\"" << filePath << "\" has invalid parameters." << std::endl;
+        return nullptr;
+    }
+
+    header.domainLen = domain.size();
+    memcpy(header.domain, domain.data(), domain.size());
+    memcpy(header.hashMethod, hashMethodName.c_str(), hashMethodName.size() + 1);
+
+    // Options added after the original parameters.
+    std::string option;
+
+    while (params >> option) {
+        size_t eq = option.find('=');
+        std::string key = option.substr(0, eq);
+        std::string value = eq == std::string::npos ? "" : option.substr(eq + 1);
+        std::vector<unsigned int> values;
+        uint64_t number;
+        unsigned int reduction;
+
+        if (key == "checkpoints" && parseList(value, values) && values.size() <= MAX_CHECKPOINTS) {
+            header.nCheckpoints = values.size();
+            std::copy(values.begin(), values.end(), header.checkpoints);
+        } else if (key == "perfect" && (value == "0" || value == "1")) {
+            header.perfect = value == "1";
+        } else if (key == "dp" && parseList(value, values) && values.size() == 1 && values[0] <= MAX_DP_BITS) {
+            header.dpBits = values[0];
+        } else if (key == "table" && parseList(value, values) && values.size() == 1) {
+            header.tableIndex = values[0];
+        } else if (key == "filter" && parseList(value, values) && values.size() == 1
+                   && values[0] <= BLOOM_MAX_BITS_PER_KEY) {
+            header.filterBits = values[0];
+        } else if (key == "seed" && parseNumber(value, number)) {
+            header.startSeed = number;
+        } else if (key == "counter" && parseNumber(value, number)) {
+            header.startCount = number;
+        } else if (key == "reduction" && Reduction::parse(value, reduction)) {
+            header.reduction = reduction;
+        } else if (key == "min" && parseList(value, values) && values.size() == 1 && values[0] >= 1
+                   && values[0] <= header.pwdLen) {
+            header.minLen = values[0];
+        } else if (key == "mask" && !value.empty() && value.size() < TABLE_FILE_MAX_MASK) {
+            memcpy(header.mask, value.c_str(), value.size() + 1);
+        } else if (key == "directory" && (value == "0" || value == "1")) {
+            // The size of the directory follows from the number of chains.
+            header.directoryBits = value == "1";
+        } else {
+            std::cerr << "\"" << filePath << "\" has an invalid option \"" << option << "\"." << std::endl;
+            return nullptr;
+        }
+    }
+
+    const int nThreads = omp_get_max_threads();
+
+    // One chunk per thread, every chunk starting at the beginning of a line.
+    std::vector<char const *> bounds(nThreads + 1);
+    bounds[0] = body;
+    bounds[nThreads] = end;
+
+    for (int t = 1; t < nThreads; ++t) {
+        char const *p = std::max(body + (end - body) / nThreads * t, bounds[t - 1]);
+        auto const *next = static_cast<char const *>(memchr(p, '\n', end - p));
+        bounds[t] = next ? next + 1 : end;
+    }
+
+    // Every line holds at most one chain, so the rows of every chunk are
+    // reserved from its number of lines.
+    std::vector<size_t> firstRow(nThreads + 1, 0);
+    std::vector<size_t> parsed(nThreads), invalid(nThreads);
+
+    for (int t = 0; t < nThreads; ++t) {
+        size_t lines = std::count(bounds[t], bounds[t + 1], '\n');
+        if (bounds[t + 1] > bounds[t] && bounds[t + 1][-1] != '\n')
+            ++lines;
+        firstRow[t + 1] = firstRow[t] + lines;
+    }
+
+    auto *table = new Table(firstRow[nThreads], header.pwdLen, header.nCheckpoints);
+    table->ends.resize(firstRow[nThreads]);
+    table->starts.resize(firstRow[nThreads] * header.pwdLen);
+    if (header.nCheckpoints > 0)
+        table->pendingChecks.resize(firstRow[nThreads]);
+
+    const unsigned int minLen = header.minLen > 0 ? header.minLen : header.pwdLen;
+
+    #pragma omp parallel default(none) shared(bounds, firstRow, parsed, invalid, table, minLen)
+    {
+        int t = omp_get_thread_num();
+        parsed[t] = parseChunk(bounds[t], bounds[t + 1], *table, firstRow[t], minLen, invalid[t]);
+    }
+
+    // Close the gaps left by blank and malformed lines.
+    size_t n = 0, nInvalid = 0;
+
+    for (int t = 0; t < nThreads; ++t) {
+        if (firstRow[t] != n) {
+            memmove(&table->ends[n], &table->ends[firstRow[t]], parsed[t] * sizeof(Endpoint));
+            memmove(&table->starts[n * header.pwdLen], &table->starts[firstRow[t] * header.pwdLen],
+                    parsed[t] * header.pwdLen);
+            if (header.nCheckpoints > 0)
+                memmove(&table->pendingChecks[n], &table->pendingChecks[firstRow[t]], parsed[t] * sizeof(uint64_t));
+        }
+        n += parsed[t];
+        nInvalid += invalid[t];
+    }
+
+    table->ends.resize(n);
+    table->starts.resize(n * header.pwdLen);
+    if (header.nCheckpoints > 0)
+        table->pendingChecks.resize(n);
+
+    if (nInvalid > 0)
+        std::cerr << "Skipped " << nInvalid << " malformed lines." << std::endl;
+
+    header.nChains = n;
+
+    // Tables written by write() are already sorted, which build() notices.
+    // The filter and the directory are not stored in text files, but rebuilt.
+    return TableBuilder(0, header.pwdLen, table).setFilter(header.filterBits)
+            ->setDirectory(header.directoryBits > 0, header.dpBits)->build();
+}
+
+bool TextTableFile::write(std::string const &filePath, TableFileHeader const &header, Table const &table) {
+
+    if (table.isCompact()) {
+        // Truncated end hashes cannot be written back as full hashes.
+        std::cerr << "A compact table can only be written to a " TABLE_FILE_EXTENSION " file." << std::endl;
+        return false;
+    }
+
+    std::ofstream out(filePath.c_str(), std::ios::binary | std::ios::trunc);
+
+    if (!out) {
+        std::cerr << "Could not write to file \"" << filePath << "\"." << std::endl;
+        return false;
+    }
+
+    const size_t n = table.size();
+    const unsigned int pwdLen = table.pwdLen;
+
+    out << header.chainLen << " "                           // Length of the chains.
+        << n << " "                                         // Number of chains
+        << std::string(header.domain, header.domainLen) << " "   // Available chars
+        << pwdLen << " "                                    // Length of the passwords
+        << header.hashMethod;                               // Name of the hashing method.
+
+    if (table.nChecks > 0)
+        out << " checkpoints=" << formatList(header.checkpoints, header.nCheckpoints);
+    if (header.perfect)
+        out << " perfect=1";
+    if (header.dpBits > 0)
+        out << " dp=" << header.dpBits;
+    if (header.tableIndex > 0)
+        out << " table=" << header.tableIndex;
+    if (table.getFilterBits() > 0)
+        out << " filter=" << table.getFilterBits();
+    if (table.hasDirectory())
+        out << " directory=1";
+    if (header.startSeed > 0)
+        out << " seed=" << header.startSeed;
+    if (header.startCount > 0)
+        out << " counter=" << header.startCount;
+    if (header.reduction != REDUCE_BYTES)
+        out << " reduction=" << Reduction::name(header.reduction);
+    if (header.minLen > 0)
+        out << " min=" << header.minLen;
+    if (header.mask[0] != '\0')
+        out << " mask=" << header.mask;
+
+    out << "\n";
+
+    // Every line has the same length, so the lines of a block are
+    // formatted in place, in parallel.
+    const unsigned int checkDigits = (table.nChecks + 3) / 4;
+    const size_t lineLen = pwdLen + 2 * HASH_SIZE + 2 + (checkDigits > 0 ? checkDigits + 1 : 0);
+    const size_t blockRows = (size_t) TEXT_BLOCK_ROWS * omp_get_max_threads();
+
+    std::vector<char> buffer(std::min(blockRows, n) * lineLen);
+    Endpoint const *ends = table.endData();
+    unsigned char const *starts = table.startData();
+
+    for (size_t first = 0; first < n && out; first += blockRows) {
+        const long rows = (long) std::min(blockRows, n - first);
+
+        #pragma omp parallel for default(none) shared(buffer, ends, starts, table, first, rows, lineLen, pwdLen, checkDigits)
+        for (long i = 0; i < rows; ++i) {
+            unsigned char hash[HASH_SIZE];
+            char *line = &buffer[i * lineLen];
+
+            memcpy(line, starts + (first + i) * pwdLen, pwdLen);
+            // The null bytes after a shorter start password.
+            std::replace(line, line + pwdLen, '\0', ' ');
+            line[pwdLen] = ' ';
+            ends[first + i].getHash(hash);
+            encodeHex(hash, line + pwdLen + 1);
+            if (checkDigits > 0) {
+                line[pwdLen + 2 * HASH_SIZE + 1] = ' ';
+                encodeChecks(table.getChecks(first + i), checkDigits, line + pwdLen + 2 * HASH_SIZE + 2);
+            }
+            line[lineLen - 1] = '\n';
+        }
+
+        out.write(buffer.data(), rows * lineLen);
+    }
+
+    out.close();
+
+    if (!out) {
+        std::cerr << "Could not write to file \"" << filePath << "\"." << std::endl;
+        return false;
+    }
+
+    return true;
+}
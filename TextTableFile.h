@@ -0,0 +1,101 @@
+#ifndef RAINBOWHACKING_TEXTTABLEFILE_H
+#define RAINBOWHACKING_TEXTTABLEFILE_H
+
+#include <string>
+#include <vector>
+#include "TableFile.h"
+
+#define TEXT_BLOCK_ROWS 65536   /* Rows formatted by every thread before a write */
+
+/**
+ * Reads and writes tables in the text format: a line of parameters
+ * "chainLen nChains domain pwdLen hashMethod", possibly followed by
+ * "key=value" options, then one line per chain with its start password,
+ * its end hash in hexadecimal and, if the table has checkpoints, its
+ * checkpoint bits in hexadecimal. Start passwords shorter than pwdLen are
+ * padded with spaces, so that every line has the same length.
+ *
+ * The file is mapped and cut into one chunk per thread at line boundaries,
+ * and the chunks are parsed in parallel. Lines are written in large
+ * blocks, formatted in parallel, so that both ways are bound by I/O.
+ */
+class TextTableFile {
+
+private:
+    /**
+     * Decodes <nDigits> hexadecimal digits of checkpoint bits, the most significant first.
+     * @return false if a character is not an hexadecimal digit.
+     */
+    static bool decodeChecks(char const *text, unsigned int nDigits, uint64_t &checks);
+
+    /**
+     * Encodes checkpoint bits as <nDigits> hexadecimal digits, the most significant first.
+     */
+    static void encodeChecks(uint64_t checks, unsigned int nDigits, char *text);
+
+    /**
+     * Parses the chains of a chunk of lines into consecutive rows of a table.
+     * @param first: Row of the first chain of the chunk.
+     * @param minLen: Length of the shortest start passwords.
+     * @param invalid: Placeholder for the number of malformed lines.
+     * @return The number of chains parsed.
+     */
+    static size_t parseChunk(char const *begin, char const *end, Table &table, size_t first, unsigned int minLen,
+                             size_t &invalid);
+
+public:
+    /**
+     * Decodes a hexadecimal hash, in upper or lower case.
+     * @param text: The 2 * HASH_SIZE hexadecimal digits.
+     * @param hash: Placeholder for the HASH_SIZE bytes.
+     * @return false if a character is not an hexadecimal digit.
+     */
+    static bool decodeHex(char const *text, unsigned char *hash);
+
+    /**
+     * Encodes a hash in upper case hexadecimal.
+     * @param hash: The HASH_SIZE bytes.
+     * @param text: Placeholder for the 2 * HASH_SIZE digits, not null terminated.
+     */
+    static void encodeHex(unsigned char const *hash, char *text);
+
+    /**
+     * Parses a comma separated list of numbers.
+     * @param text: The list, such as "10,20,30".
+     * @param values: Placeholder for the numbers.
+     * @return false if the list is malformed.
+     */
+    static bool parseList(std::string const &text, std::vector<unsigned int> &values);
+
+    /**
+     * Parses a 64 bits number.
+     * @param text: The number, in decimal.
+     * @param value: Placeholder for the number.
+     * @return false if the number is malformed.
+     */
+    static bool parseNumber(std::string const &text, uint64_t &value);
+
+    /**
+     * Formats numbers as a comma separated list.
+     */
+    static std::string formatList(unsigned int const *values, unsigned int n);
+
+    /**
+     * Reads a table.
+     * @param filePath: The path of the file to read from.
+     * @param header: Placeholder for the parameters of the table.
+     * @return The table, or nullptr on error.
+     */
+    static Table *read(std::string const &filePath, TableFileHeader &header);
+
+    /**
+     * Writes a table. Compact tables cannot be written, their end hashes being truncated.
+     * @param filePath: The path of the file to write to.
+     * @param header: The parameters of the table: chainLen, domain, pwdLen, hashMethod and checkpoints.
+     * @param table: The table to write.
+     * @return true if the table has been written.
+     */
+    static bool write(std::string const &filePath, TableFileHeader const &header, Table const &table);
+};
+
+#endif //RAINBOWHACKING_TEXTTABLEFILE_H